@@ -104,6 +104,18 @@ def complete_config(config):
              print("Cannot find security level for {:s} {:s}. Setting to 0.".format(famsig['family'], sig['name']))
              bits_level = 0
          sig['security'] = bits_level
+   # signature key types by TLS name, for binary search in oqsprov_keys.c:
+   # Python orders str by code point, which matches strcmp() on ASCII names
+   nid_names = []
+   for famsig in config['sigs']:
+      for sig in famsig['variants']:
+         nid_names.append({'tlsname': sig['name'], 'oqs_meth': sig['oqs_meth'],
+                           'keytype': 'KEY_TYPE_SIG', 'security': sig['security']})
+         for classical_alg in sig['mix_with']:
+            nid_names.append({'tlsname': classical_alg['name'] + '_' + sig['name'],
+                              'oqs_meth': sig['oqs_meth'],
+                              'keytype': 'KEY_TYPE_HYB_SIG', 'security': sig['security']})
+   config['sig_nid_names'] = sorted(nid_names, key=lambda e: e['tlsname'])
    return config
 
 def run_subprocess(command, outfilename=None, working_dir='.', expected_returncode=0, input=None, ignore_returncode=False):
@@ -200,6 +212,7 @@ config = complete_config(config)
 
 populate('test/oqs_test_signatures.c', config, '/////')
 populate('test/oqs_test_kems.c', config, '/////')
+populate('test/oqs_bench_kem.c', config, '/////')
 populate('test/oqs_test_groups.c', config, '/////')
 populate('test/oqs_test_endecode.c', config, '/////')
 populate('oqsprov/oqsencoders.inc', config, '/////')
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * OQS OpenSSL 3 provider
+ *
+ * Batch signature operations. A batch is passed by pointer in an
+ * OSSL_PARAM_octet_ptr ctx parameter of an EVP_PKEY_CTX initialized for
+ * the matching operation with a key of this provider, e.g.
+ *
+ *     OQSPROV_BATCH_VERIFY batch = { items, nitems, results, 0 };
+ *     void *pbatch = &batch;
+ *     OSSL_PARAM params[2] = {
+ *         OSSL_PARAM_octet_ptr(OQSPROV_PARAM_BATCH_VERIFY, &pbatch, sizeof(batch)),
+ *         OSSL_PARAM_END
+ *     };
+ *
+ *     EVP_PKEY_verify_init(ctx);
+ *     EVP_PKEY_CTX_set_params(ctx, params);
+ *
+ * Setting the parameter runs the whole batch, spread across the provider's
+ * worker threads, before EVP_PKEY_CTX_set_params() returns.
+ *
+ * Batch signing (OQSPROV_PARAM_BATCH_SIGN, after EVP_PKEY_sign_init()) signs
+ * all items with the key of the context.
+ */
+
+#ifndef OQS_BATCH_H
+#define OQS_BATCH_H
+
+#include <stddef.h>
+#include <openssl/evp.h>
+
+#define OQSPROV_PARAM_BATCH_VERIFY "batch-verify"
+#define OQSPROV_PARAM_BATCH_SIGN   "batch-sign"
+
+typedef struct {
+    /* NULL for the key the EVP_PKEY_CTX was initialized with */
+    EVP_PKEY *key;
+    const unsigned char *tbs;
+    size_t tbslen;
+    const unsigned char *sig;
+    size_t siglen;
+} OQSPROV_BATCH_VERIFY_ITEM;
+
+typedef struct {
+    const OQSPROV_BATCH_VERIFY_ITEM *items;
+    size_t nitems;
+    /* (nitems + 7) / 8 bytes; bit i % 8 of byte i / 8 is set iff item i verified */
+    unsigned char *results;
+    /* set to the number of items that verified */
+    size_t nverified;
+} OQSPROV_BATCH_VERIFY;
+
+typedef struct {
+    const unsigned char *tbs;
+    size_t tbslen;
+    unsigned char *sig;
+    /* size of sig on input, length of the signature (0 on failure) on return */
+    size_t siglen;
+} OQSPROV_BATCH_SIGN_ITEM;
+
+typedef struct {
+    OQSPROV_BATCH_SIGN_ITEM *items;
+    size_t nitems;
+    /* spread items across the worker threads rather than sign them inline */
+    int parallel;
+    /* set to the number of items signed; setting the parameter fails
+     * unless all were */
+    size_t nsigned;
+} OQSPROV_BATCH_SIGN;
+
+#endif
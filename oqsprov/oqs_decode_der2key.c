@@ -25,15 +25,9 @@ int asn1_d2i_read_bio(BIO *in, BUF_MEM **pb); // TBD: OK to use?
 
 #include "oqs_endecoder_local.h"
 
-#ifdef NDEBUG
-#define OQS_DEC_PRINTF(a)
-#define OQS_DEC_PRINTF2(a, b)
-#define OQS_DEC_PRINTF3(a, b, c)
-#else
-#define OQS_DEC_PRINTF(a) if (getenv("OQSDEC")) printf(a)
-#define OQS_DEC_PRINTF2(a, b) if (getenv("OQSDEC")) printf(a, b)
-#define OQS_DEC_PRINTF3(a, b, c) if (getenv("OQSDEC")) printf(a, b, c)
-#endif // NDEBUG
+#define OQS_DEC_PRINTF(a) OQSX_TRACE(OQSX_TRACE_DEC, a)
+#define OQS_DEC_PRINTF2(a, b) OQSX_TRACE(OQSX_TRACE_DEC, a, b)
+#define OQS_DEC_PRINTF3(a, b, c) OQSX_TRACE(OQSX_TRACE_DEC, a, b, c)
 
 struct der2key_ctx_st;           /* Forward declaration */
 typedef int check_key_fn(void *, struct der2key_ctx_st *ctx);
@@ -274,6 +268,7 @@ static int oqs_der2key_decode(void *vctx, OSSL_CORE_BIO *cin, int selection,
     long der_len = 0;
     void *key = NULL;
     int ok = 0;
+    uint64_t start = oqsx_stats_now();
 
     OQS_DEC_PRINTF("OQS DEC provider: oqs_der2key_decode called.\n");
 
@@ -344,6 +339,9 @@ static int oqs_der2key_decode(void *vctx, OSSL_CORE_BIO *cin, int selection,
 
     if (key != NULL && ctx->desc->adjust_key != NULL)
         ctx->desc->adjust_key(key, ctx);
+    // inputs of other key types are not counted
+    if (key != NULL)
+        oqsx_stats_record(((OQSX_KEY *)key)->stats, OQSX_OP_DECODE, start, 1);
 
  next:
     /*
@@ -424,6 +422,90 @@ static void oqsx_key_adjust(void *key, struct der2key_ctx_st *ctx)
     oqsx_key_set0_libctx(key, PROV_OQS_LIBCTX_OF(ctx->provctx));
 }
 
+/* ---------------------------------------------------------------------- */
+
+/*
+ * PrivateKeyInfo to PrivateKeyInfo decoder, like OpenSSL's spki2typespki
+ * for SubjectPublicKeyInfo: it reads the algorithm OID once and passes the
+ * DER on typed with the matching OQS key type, so that OpenSSL offers it
+ * to that key type's decoder only instead of every PrivateKeyInfo decoder
+ * of this provider parsing and rejecting it in turn.
+ */
+static OSSL_FUNC_decoder_newctx_fn pki2typepki_newctx;
+static OSSL_FUNC_decoder_freectx_fn pki2typepki_freectx;
+static OSSL_FUNC_decoder_decode_fn pki2typepki_decode;
+
+static void *pki2typepki_newctx(void *provctx)
+{
+    struct der2key_ctx_st *ctx = OPENSSL_zalloc(sizeof(*ctx));
+
+    OQS_DEC_PRINTF("OQS DEC provider: pki2typepki_newctx called.\n");
+
+    if (ctx != NULL)
+        ctx->provctx = provctx;
+    return ctx;
+}
+
+static void pki2typepki_freectx(void *vctx)
+{
+    OPENSSL_free(vctx);
+}
+
+static int pki2typepki_decode(void *vctx, OSSL_CORE_BIO *cin, int selection,
+                              OSSL_CALLBACK *data_cb, void *data_cbarg,
+                              OSSL_PASSPHRASE_CALLBACK *pw_cb, void *pw_cbarg)
+{
+    struct der2key_ctx_st *ctx = vctx;
+    unsigned char *der = NULL;
+    const unsigned char *derp;
+    long der_len = 0;
+    PKCS8_PRIV_KEY_INFO *p8inf = NULL;
+    const X509_ALGOR *alg = NULL;
+    const char *keytype = NULL;
+    int ok = 1;
+
+    OQS_DEC_PRINTF("OQS DEC provider: pki2typepki_decode called.\n");
+
+    /* Not being able to read or parse the input is not an error */
+    if (!oqs_read_der(ctx->provctx, cin, &der, &der_len))
+        return 1;
+
+    derp = der;
+    if ((p8inf = d2i_PKCS8_PRIV_KEY_INFO(NULL, &derp, der_len)) != NULL
+        && PKCS8_pkey_get0(NULL, NULL, NULL, &alg, p8inf))
+        keytype = oqs_get_tlsname(OBJ_obj2nid(alg->algorithm));
+    PKCS8_PRIV_KEY_INFO_free(p8inf);
+
+    if (keytype != NULL) {
+        OSSL_PARAM params[5];
+        int object_type = OSSL_OBJECT_PKEY;
+
+        OQS_DEC_PRINTF2("OQS DEC provider: pki2typepki_decode found %s.\n", keytype);
+        params[0] =
+            OSSL_PARAM_construct_utf8_string(OSSL_OBJECT_PARAM_DATA_TYPE,
+                                             (char *)keytype, 0);
+        params[1] =
+            OSSL_PARAM_construct_utf8_string(OSSL_OBJECT_PARAM_DATA_STRUCTURE,
+                                             "PrivateKeyInfo", 0);
+        params[2] =
+            OSSL_PARAM_construct_octet_string(OSSL_OBJECT_PARAM_DATA,
+                                              der, der_len);
+        params[3] =
+            OSSL_PARAM_construct_int(OSSL_OBJECT_PARAM_TYPE, &object_type);
+        params[4] = OSSL_PARAM_construct_end();
+
+        ok = data_cb(params, data_cbarg);
+    }
+    OPENSSL_free(der);
+    return ok;
+}
+
+const OSSL_DISPATCH oqs_PrivateKeyInfo_der_to_der_decoder_functions[] = {
+    { OSSL_FUNC_DECODER_NEWCTX, (void (*)(void))pki2typepki_newctx },
+    { OSSL_FUNC_DECODER_FREECTX, (void (*)(void))pki2typepki_freectx },
+    { OSSL_FUNC_DECODER_DECODE, (void (*)(void))pki2typepki_decode },
+    { 0, NULL }
+};
 
 // OQS provider uses NIDs generated at load time as EVP_type identifiers
 // so initially this must be 0 and set to a real value by OBJ_sn2nid later
@@ -29,15 +29,9 @@
 #include <string.h>
 #include "oqs_endecoder_local.h"
 
-#ifdef NDEBUG
-#define OQS_ENC_PRINTF(a)
-#define OQS_ENC_PRINTF2(a, b)
-#define OQS_ENC_PRINTF3(a, b, c)
-#else
-#define OQS_ENC_PRINTF(a) if (getenv("OQSENC")) printf(a)
-#define OQS_ENC_PRINTF2(a, b) if (getenv("OQSENC")) printf(a, b)
-#define OQS_ENC_PRINTF3(a, b, c) if (getenv("OQSENC")) printf(a, b, c)
-#endif // NDEBUG
+#define OQS_ENC_PRINTF(a) OQSX_TRACE(OQSX_TRACE_ENC, a)
+#define OQS_ENC_PRINTF2(a, b) OQSX_TRACE(OQSX_TRACE_ENC, a, b)
+#define OQS_ENC_PRINTF3(a, b, c) OQSX_TRACE(OQSX_TRACE_ENC, a, b, c)
 
 struct key2any_ctx_st {
     PROV_OQS_CTX *provctx;
@@ -520,6 +514,8 @@ static int oqsx_spki_pub_to_der(const void *vecxkey, unsigned char **pder)
         ERR_raise(ERR_LIB_USER, ERR_R_PASSED_NULL_PARAMETER);
         return 0;
     }
+    if (!oqsx_key_complete_pubkey(oqsxkey))
+        return 0;
 
     keyblob = OPENSSL_memdup(oqsxkey->pubkey, oqsxkey->pubkeylen);
     if (keyblob == NULL) {
@@ -837,6 +833,7 @@ static int key2any_encode(struct key2any_ctx_st *ctx, OSSL_CORE_BIO *cout,
     int ret = 0;
     int type = OBJ_sn2nid(typestr);
     OQSX_KEY *oqsk = (OQSX_KEY*)key;
+    uint64_t start = oqsx_stats_now();
 
     OQS_ENC_PRINTF3("OQS ENC provider: key2any_encode called with type %d (%s)\n", type, typestr);
     OQS_ENC_PRINTF2("OQS ENC provider: key2any_encode called with pemname %s\n", pemname);
@@ -859,6 +856,8 @@ static int key2any_encode(struct key2any_ctx_st *ctx, OSSL_CORE_BIO *cout,
         ERR_raise(ERR_LIB_USER, ERR_R_PASSED_INVALID_ARGUMENT);
     }
     OQS_ENC_PRINTF2(" encode result: %d\n", ret);
+    if (oqsk != NULL)
+        oqsx_stats_record(oqsk->stats, OQSX_OP_ENCODE, start, ret);
     return ret;
 }
 
@@ -18,15 +18,10 @@
 #include <string.h>
 #include "oqs_prov.h"
 
-#ifdef NDEBUG
-#define OQS_KEM_PRINTF(a)
-#define OQS_KEM_PRINTF2(a, b)
-#define OQS_KEM_PRINTF3(a, b, c)
-#else
-#define OQS_KEM_PRINTF(a) if (getenv("OQSKEM")) printf(a)
-#define OQS_KEM_PRINTF2(a, b) if (getenv("OQSKEM")) printf(a, b)
-#define OQS_KEM_PRINTF3(a, b, c) if (getenv("OQSKEM")) printf(a, b, c)
-#endif // NDEBUG
+#define OQS_KEM_PRINTF(a) OQSX_TRACE(OQSX_TRACE_KEM, a)
+#define OQS_KEM_PRINTF2(a, b) OQSX_TRACE(OQSX_TRACE_KEM, a, b)
+#define OQS_KEM_PRINTF3(a, b, c) OQSX_TRACE(OQSX_TRACE_KEM, a, b, c)
+#define OQS_KEM_PROBE_ALG(pkemctx) ((pkemctx)->kem != NULL ? (pkemctx)->kem->tls_name : NULL)
 
 
 static OSSL_FUNC_kem_newctx_fn oqs_kem_newctx;
@@ -36,6 +31,10 @@ static OSSL_FUNC_kem_encapsulate_fn oqs_hyb_kem_encaps;
 static OSSL_FUNC_kem_decapsulate_fn oqs_qs_kem_decaps;
 static OSSL_FUNC_kem_decapsulate_fn oqs_hyb_kem_decaps;
 static OSSL_FUNC_kem_freectx_fn oqs_kem_freectx;
+static OSSL_FUNC_kem_get_ctx_params_fn oqs_kem_get_ctx_params;
+static OSSL_FUNC_kem_gettable_ctx_params_fn oqs_kem_gettable_ctx_params;
+static OSSL_FUNC_kem_set_ctx_params_fn oqs_kem_set_ctx_params;
+static OSSL_FUNC_kem_settable_ctx_params_fn oqs_kem_settable_ctx_params;
 
 /*
  * What's passed as an actual key is defined by the KEYMGMT interface.
@@ -43,8 +42,25 @@ static OSSL_FUNC_kem_freectx_fn oqs_kem_freectx;
 typedef struct {
     OSSL_LIB_CTX *libctx;
     OQSX_KEY *kem;
+    /* derive context of the classical key, reused across decapsulations */
+    EVP_PKEY_CTX *derive_ctx;
+    /* run classical and PQ halves of hybrid KEMs concurrently */
+    PROV_OQS_CTX *provctx;
+    int hybrid_parallel;
 } PROV_OQSKEM_CTX;
 
+/* PQ keyslot of a hybrid operation; may be run on a provider worker thread */
+typedef struct {
+    void *pkemctx;
+    unsigned char *out;
+    size_t outlen;
+    unsigned char *secret;
+    size_t secretlen;
+    const unsigned char *in;
+    size_t inlen;
+    int keyslot;
+} OQSX_PQ_KEM_JOB;
+
 /// Common KEM functions
 
 static void *oqs_kem_newctx(void *provctx)
@@ -55,6 +71,8 @@ static void *oqs_kem_newctx(void *provctx)
     if (pkemctx == NULL)
         return NULL;
     pkemctx->libctx = PROV_OQS_LIBCTX_OF(provctx);
+    pkemctx->provctx = provctx;
+    pkemctx->hybrid_parallel = ((PROV_OQS_CTX *)provctx)->hybrid_parallel;
     // kem will only be set in init
 
     return pkemctx;
@@ -65,6 +83,7 @@ static void oqs_kem_freectx(void *vpkemctx)
     PROV_OQSKEM_CTX *pkemctx = (PROV_OQSKEM_CTX *)vpkemctx;
 
     OQS_KEM_PRINTF("OQS KEM provider called: freectx\n");
+    EVP_PKEY_CTX_free(pkemctx->derive_ctx);
     oqsx_key_free(pkemctx->kem);
     OPENSSL_free(pkemctx);
 }
@@ -74,10 +93,13 @@ static int oqs_kem_decapsencaps_init(void *vpkemctx, void *vkem, int operation)
     PROV_OQSKEM_CTX *pkemctx = (PROV_OQSKEM_CTX *)vpkemctx;
 
     OQS_KEM_PRINTF3("OQS KEM provider called: _init : New: %p; old: %p \n", vkem, pkemctx->kem);
-    if (pkemctx == NULL || vkem == NULL || !oqsx_key_up_ref(vkem)) 
+    if (pkemctx == NULL || vkem == NULL || !oqsx_key_materialize(vkem)
+        || !oqsx_key_up_ref(vkem))
         return 0;
     oqsx_key_free(pkemctx->kem);
     pkemctx->kem = vkem;
+    EVP_PKEY_CTX_free(pkemctx->derive_ctx);
+    pkemctx->derive_ctx = NULL;
 
     return 1;
 }
@@ -85,13 +107,68 @@ static int oqs_kem_decapsencaps_init(void *vpkemctx, void *vkem, int operation)
 static int oqs_kem_encaps_init(void *vpkemctx, void *vkem, const OSSL_PARAM params[])
 {
     OQS_KEM_PRINTF("OQS KEM provider called: encaps_init\n");
-    return oqs_kem_decapsencaps_init(vpkemctx, vkem, EVP_PKEY_OP_ENCAPSULATE);
+    return oqs_kem_decapsencaps_init(vpkemctx, vkem, EVP_PKEY_OP_ENCAPSULATE)
+           && oqs_kem_set_ctx_params(vpkemctx, params);
 }
 
 static int oqs_kem_decaps_init(void *vpkemctx, void *vkem, const OSSL_PARAM params[])
 {
     OQS_KEM_PRINTF("OQS KEM provider called: decaps_init\n");
-    return oqs_kem_decapsencaps_init(vpkemctx, vkem, EVP_PKEY_OP_DECAPSULATE);
+    return oqs_kem_decapsencaps_init(vpkemctx, vkem, EVP_PKEY_OP_DECAPSULATE)
+           && oqs_kem_set_ctx_params(vpkemctx, params);
+}
+
+static int oqs_kem_get_ctx_params(void *vpkemctx, OSSL_PARAM *params)
+{
+    PROV_OQSKEM_CTX *pkemctx = (PROV_OQSKEM_CTX *)vpkemctx;
+    OSSL_PARAM *p;
+
+    if (pkemctx == NULL)
+        return 0;
+
+    p = OSSL_PARAM_locate(params, OQSPROV_PARAM_HYBRID_PARALLEL);
+    if (p != NULL && !OSSL_PARAM_set_int(p, pkemctx->hybrid_parallel))
+        return 0;
+
+    return 1;
+}
+
+static const OSSL_PARAM known_gettable_kem_ctx_params[] = {
+    OSSL_PARAM_int(OQSPROV_PARAM_HYBRID_PARALLEL, NULL),
+    OSSL_PARAM_END
+};
+
+static const OSSL_PARAM *oqs_kem_gettable_ctx_params(ossl_unused void *vpkemctx,
+                                                     ossl_unused void *provctx)
+{
+    return known_gettable_kem_ctx_params;
+}
+
+static int oqs_kem_set_ctx_params(void *vpkemctx, const OSSL_PARAM params[])
+{
+    PROV_OQSKEM_CTX *pkemctx = (PROV_OQSKEM_CTX *)vpkemctx;
+    const OSSL_PARAM *p;
+
+    OQS_KEM_PRINTF("OQS KEM provider called: set_ctx_params\n");
+    if (pkemctx == NULL)
+        return 0;
+
+    p = OSSL_PARAM_locate_const(params, OQSPROV_PARAM_HYBRID_PARALLEL);
+    if (p != NULL && !OSSL_PARAM_get_int(p, &pkemctx->hybrid_parallel))
+        return 0;
+
+    return 1;
+}
+
+static const OSSL_PARAM known_settable_kem_ctx_params[] = {
+    OSSL_PARAM_int(OQSPROV_PARAM_HYBRID_PARALLEL, NULL),
+    OSSL_PARAM_END
+};
+
+static const OSSL_PARAM *oqs_kem_settable_ctx_params(ossl_unused void *vpkemctx,
+                                                     ossl_unused void *provctx)
+{
+    return known_settable_kem_ctx_params;
 }
 
 /// Quantum-Safe KEM functions (OQS)
@@ -136,13 +213,48 @@ static int oqs_qs_kem_decaps_keyslot(void *vpkemctx, unsigned char *out, size_t
 static int oqs_qs_kem_encaps(void *vpkemctx, unsigned char *out, size_t *outlen,
                              unsigned char *secret, size_t *secretlen)
 {
-    return oqs_qs_kem_encaps_keyslot(vpkemctx, out, outlen, secret, secretlen, 0);
+    const PROV_OQSKEM_CTX *pkemctx = (PROV_OQSKEM_CTX *)vpkemctx;
+    uint64_t start = oqsx_stats_now();
+    int ret;
+
+    OQSX_PROBE_ENTRY(encaps, OQS_KEM_PROBE_ALG(pkemctx));
+    ret = oqs_qs_kem_encaps_keyslot(vpkemctx, out, outlen, secret, secretlen, 0);
+    // length queries are not counted
+    if (pkemctx->kem != NULL && out != NULL && secret != NULL)
+        oqsx_stats_record(pkemctx->kem->stats, OQSX_OP_ENCAPS, start, ret > 0);
+    OQSX_PROBE_RETURN(encaps, OQS_KEM_PROBE_ALG(pkemctx), ret > 0);
+    return ret;
 }
 
 static int oqs_qs_kem_decaps(void *vpkemctx, unsigned char *out, size_t *outlen,
                              const unsigned char *in, size_t inlen)
 {
-    return oqs_qs_kem_decaps_keyslot(vpkemctx, out, outlen, in, inlen, 0);
+    const PROV_OQSKEM_CTX *pkemctx = (PROV_OQSKEM_CTX *)vpkemctx;
+    uint64_t start = oqsx_stats_now();
+    int ret;
+
+    OQSX_PROBE_ENTRY(decaps, OQS_KEM_PROBE_ALG(pkemctx));
+    ret = oqs_qs_kem_decaps_keyslot(vpkemctx, out, outlen, in, inlen, 0);
+    if (pkemctx->kem != NULL && out != NULL)
+        oqsx_stats_record(pkemctx->kem->stats, OQSX_OP_DECAPS, start, ret > 0);
+    OQSX_PROBE_RETURN(decaps, OQS_KEM_PROBE_ALG(pkemctx), ret > 0);
+    return ret;
+}
+
+static int oqs_qs_kem_encaps_job(void *arg)
+{
+    OQSX_PQ_KEM_JOB *job = arg;
+
+    return oqs_qs_kem_encaps_keyslot(job->pkemctx, job->out, &job->outlen,
+                                     job->secret, &job->secretlen, job->keyslot) > 0;
+}
+
+static int oqs_qs_kem_decaps_job(void *arg)
+{
+    OQSX_PQ_KEM_JOB *job = arg;
+
+    return oqs_qs_kem_decaps_keyslot(job->pkemctx, job->secret, &job->secretlen,
+                                     job->in, job->inlen, job->keyslot) > 0;
 }
 
 /// EVP KEM functions
@@ -184,14 +296,19 @@ static int oqs_evp_kem_encaps_keyslot(void *vpkemctx, unsigned char *ct, size_t
     ret2 = EVP_PKEY_set1_encoded_public_key(peerpk, pubkey_kex, pubkey_kexlen);
     ON_ERR_SET_GOTO(ret2 <= 0, ret, -1, err);
 
-    kgctx = EVP_PKEY_CTX_new(evp_ctx->keyParam, NULL);
-    ON_ERR_SET_GOTO(!kgctx, ret, -1, err);
+    // use a pre-generated ephemeral key if available
+    if (pkemctx->provctx != NULL)
+        pkey = oqsx_keypool_take_ecdh(pkemctx->provctx->keypool, evp_ctx->keyParam);
+    if (pkey == NULL) {
+        kgctx = EVP_PKEY_CTX_new(evp_ctx->keyParam, NULL);
+        ON_ERR_SET_GOTO(!kgctx, ret, -1, err);
 
-    ret2 = EVP_PKEY_keygen_init(kgctx);
-    ON_ERR_SET_GOTO(ret2 != 1, ret, -1, err);
+        ret2 = EVP_PKEY_keygen_init(kgctx);
+        ON_ERR_SET_GOTO(ret2 != 1, ret, -1, err);
 
-    ret2 = EVP_PKEY_keygen(kgctx, &pkey);
-    ON_ERR_SET_GOTO(ret2 != 1, ret, -1, err);
+        ret2 = EVP_PKEY_keygen(kgctx, &pkey);
+        ON_ERR_SET_GOTO(ret2 != 1, ret, -1, err);
+    }
 
     ctx = EVP_PKEY_CTX_new(pkey, NULL);
     ON_ERR_SET_GOTO(!ctx, ret, -1, err);
@@ -225,27 +342,29 @@ static int oqs_evp_kem_decaps_keyslot(void *vpkemctx, unsigned char *secret, siz
     OQS_KEM_PRINTF("OQS KEM provider called: oqs_hyb_kem_decaps\n");
 
     int ret = OQS_SUCCESS, ret2 = 0;
-    const PROV_OQSKEM_CTX *pkemctx = (PROV_OQSKEM_CTX *)vpkemctx;
+    PROV_OQSKEM_CTX *pkemctx = (PROV_OQSKEM_CTX *)vpkemctx;
     const OQSX_EVP_CTX *evp_ctx = pkemctx->kem->oqsx_provider_ctx.oqsx_evp_ctx;
 
     size_t pubkey_kexlen = evp_ctx->evp_info->length_public_key;
     size_t kexDeriveLen = evp_ctx->evp_info->kex_length_secret;
-    unsigned char *privkey_kex = pkemctx->kem->comp_privkey[keyslot];
-    size_t privkey_kexlen = evp_ctx->evp_info->length_private_key;
+    EVP_PKEY *pkey = NULL;
 
     // Free at err:
-    EVP_PKEY_CTX *ctx = NULL;
-    EVP_PKEY *pkey = NULL, *peerpkey = NULL;
+    EVP_PKEY *peerpkey = NULL;
 
     *secretlen = kexDeriveLen;
     if (secret == NULL) return 1;
 
-    if (evp_ctx->evp_info->raw_key_support) {
-        pkey = EVP_PKEY_new_raw_private_key(evp_ctx->evp_info->keytype, NULL, privkey_kex, privkey_kexlen);
-        ON_ERR_SET_GOTO(!pkey, ret, -10, err);
-    } else {
-        pkey = d2i_AutoPrivateKey(&pkey, (const unsigned char **)&privkey_kex, privkey_kexlen);
+    if (pkemctx->derive_ctx == NULL) {
+        // classical key is owned by the OQSX_KEY
+        pkey = oqsx_key_get0_classical_pkey(pkemctx->kem);
         ON_ERR_SET_GOTO(!pkey, ret, -2, err);
+
+        pkemctx->derive_ctx = EVP_PKEY_CTX_new(pkey, NULL);
+        ON_ERR_SET_GOTO(!pkemctx->derive_ctx, ret, -6, err);
+
+        ret = EVP_PKEY_derive_init(pkemctx->derive_ctx);
+        ON_ERR_SET_GOTO(ret <= 0, ret, -7, err);
     }
 
     peerpkey = EVP_PKEY_new();
@@ -257,26 +376,31 @@ static int oqs_evp_kem_decaps_keyslot(void *vpkemctx, unsigned char *secret, siz
     ret2 = EVP_PKEY_set1_encoded_public_key(peerpkey, ct, pubkey_kexlen);
     ON_ERR_SET_GOTO(ret2 <= 0 || !peerpkey, ret, -5, err);
 
-    ctx = EVP_PKEY_CTX_new(pkey, NULL);
-    ON_ERR_SET_GOTO(!ctx, ret, -6, err);
-
-    ret = EVP_PKEY_derive_init(ctx);
-    ON_ERR_SET_GOTO(ret <= 0, ret, -7, err);
-    ret = EVP_PKEY_derive_set_peer(ctx, peerpkey);
+    ret = EVP_PKEY_derive_set_peer(pkemctx->derive_ctx, peerpkey);
     ON_ERR_SET_GOTO(ret <= 0, ret, -8, err);
 
-    ret = EVP_PKEY_derive(ctx, secret, &kexDeriveLen);
+    ret = EVP_PKEY_derive(pkemctx->derive_ctx, secret, &kexDeriveLen);
     ON_ERR_SET_GOTO(ret <= 0, ret, -9, err);
 
     err:
+    if (ret <= 0) {
+        EVP_PKEY_CTX_free(pkemctx->derive_ctx);
+        pkemctx->derive_ctx = NULL;
+    }
     EVP_PKEY_free(peerpkey);
-    EVP_PKEY_free(pkey);
-    EVP_PKEY_CTX_free(ctx);
     return ret;
 }
 
 /// Hybrid KEM functions
 
+/* returns the pool to use for the PQ keyslot, or NULL to run it inline */
+static OQSX_THREAD_POOL *oqs_hyb_kem_parallel_pool(const PROV_OQSKEM_CTX *pkemctx)
+{
+    if (!pkemctx->hybrid_parallel)
+        return NULL;
+    return oqsx_provctx_get0_pool(pkemctx->provctx);
+}
+
 static int oqs_hyb_kem_encaps(void *vpkemctx, unsigned char *ct, size_t *ctlen,
                               unsigned char *secret, size_t *secretlen)
 {
@@ -285,7 +409,13 @@ static int oqs_hyb_kem_encaps(void *vpkemctx, unsigned char *ct, size_t *ctlen,
     size_t secretLen0 = 0, secretLen1 = 0;
     size_t ctLen0 = 0, ctLen1 = 0;
     unsigned char *ct0, *ct1, *secret0, *secret1;
+    OQSX_THREAD_POOL *pool = NULL;
+    OQSX_PQ_KEM_JOB pq;
+    OQSX_JOB job;
+    int pq_queued = 0;
+    uint64_t start = oqsx_stats_now();
 
+    OQSX_PROBE_ENTRY(encaps, OQS_KEM_PROBE_ALG(pkemctx));
     ret = oqs_evp_kem_encaps_keyslot(vpkemctx, NULL, &ctLen0, NULL, &secretLen0, 0);
     ON_ERR_SET_GOTO(ret <= 0, ret, OQS_ERROR, err);
     ret = oqs_qs_kem_encaps_keyslot(vpkemctx, NULL, &ctLen1, NULL, &secretLen1, 1);
@@ -297,7 +427,8 @@ static int oqs_hyb_kem_encaps(void *vpkemctx, unsigned char *ct, size_t *ctlen,
 
     if (ct == NULL || secret == NULL) {
         OQS_KEM_PRINTF3("HYB KEM returning lengths %ld and %ld\n", *ctlen, *secretlen);
-        return 1;
+        ret = 1;
+        goto err;
     }
 
     ct0 = ct;
@@ -305,13 +436,32 @@ static int oqs_hyb_kem_encaps(void *vpkemctx, unsigned char *ct, size_t *ctlen,
     secret0 = secret;
     secret1 = secret + secretLen0;
 
+    // both halves write to disjoint parts of ct and secret
+    pq.pkemctx = vpkemctx;
+    pq.out = ct1;
+    pq.secret = secret1;
+    pq.keyslot = 1;
+    if ((pool = oqs_hyb_kem_parallel_pool(pkemctx)) != NULL)
+        pq_queued = oqsx_thread_pool_submit(pool, &job, oqs_qs_kem_encaps_job, &pq);
+
     ret = oqs_evp_kem_encaps_keyslot(vpkemctx, ct0, &ctLen0, secret0, &secretLen0, 0);
     ON_ERR_SET_GOTO(ret <= 0, ret, OQS_ERROR, err);
 
-    ret = oqs_qs_kem_encaps_keyslot(vpkemctx, ct1, &ctLen1, secret1, &secretLen1, 1);
+    if (pq_queued) {
+        pq_queued = 0;
+        ret = oqsx_thread_pool_wait(pool, &job);
+    }
+    else
+        ret = oqs_qs_kem_encaps_job(&pq);
     ON_ERR_SET_GOTO(ret <= 0, ret, OQS_ERROR, err);
 
     err:
+    if (pq_queued)
+        oqsx_thread_pool_wait(pool, &job);
+    // length queries are not counted
+    if (pkemctx->kem != NULL && ct != NULL && secret != NULL)
+        oqsx_stats_record(pkemctx->kem->stats, OQSX_OP_ENCAPS, start, ret > 0);
+    OQSX_PROBE_RETURN(encaps, OQS_KEM_PROBE_ALG(pkemctx), ret > 0);
     return ret;
 }
 
@@ -327,7 +477,13 @@ static int oqs_hyb_kem_decaps(void *vpkemctx, unsigned char *secret, size_t *sec
     size_t ctLen0 = 0, ctLen1 = 0;
     const unsigned char *ct0, *ct1;
     unsigned char *secret0, *secret1;
+    OQSX_THREAD_POOL *pool = NULL;
+    OQSX_PQ_KEM_JOB pq;
+    OQSX_JOB job;
+    int pq_queued = 0;
+    uint64_t start = oqsx_stats_now();
 
+    OQSX_PROBE_ENTRY(decaps, OQS_KEM_PROBE_ALG(pkemctx));
     ret = oqs_evp_kem_decaps_keyslot(vpkemctx, NULL, &secretLen0, NULL, 0, 0);
     ON_ERR_SET_GOTO(ret <= 0, ret, OQS_ERROR, err);
     ret = oqs_qs_kem_decaps_keyslot(vpkemctx, NULL, &secretLen1, NULL, 0, 1);
@@ -335,7 +491,10 @@ static int oqs_hyb_kem_decaps(void *vpkemctx, unsigned char *secret, size_t *sec
 
     *secretlen = secretLen0 + secretLen1;
 
-    if (secret == NULL) return 1;
+    if (secret == NULL) {
+        ret = 1;
+        goto err;
+    }
 
     ctLen0 = evp_ctx->evp_info->length_public_key;
     ctLen1 = qs_ctx->length_ciphertext;
@@ -347,12 +506,31 @@ static int oqs_hyb_kem_decaps(void *vpkemctx, unsigned char *secret, size_t *sec
     secret0 = secret;
     secret1 = secret + secretLen0;
 
+    pq.pkemctx = vpkemctx;
+    pq.secret = secret1;
+    pq.in = ct1;
+    pq.inlen = ctLen1;
+    pq.keyslot = 1;
+    if ((pool = oqs_hyb_kem_parallel_pool(pkemctx)) != NULL)
+        pq_queued = oqsx_thread_pool_submit(pool, &job, oqs_qs_kem_decaps_job, &pq);
+
     ret = oqs_evp_kem_decaps_keyslot(vpkemctx, secret0, &secretLen0, ct0, ctLen0, 0);
     ON_ERR_SET_GOTO(ret <= 0, ret, OQS_ERROR, err);
-    ret = oqs_qs_kem_decaps_keyslot(vpkemctx, secret1, &secretLen1, ct1, ctLen1, 1);
+
+    if (pq_queued) {
+        pq_queued = 0;
+        ret = oqsx_thread_pool_wait(pool, &job);
+    }
+    else
+        ret = oqs_qs_kem_decaps_job(&pq);
     ON_ERR_SET_GOTO(ret <= 0, ret, OQS_ERROR, err);
 
     err:
+    if (pq_queued)
+        oqsx_thread_pool_wait(pool, &job);
+    if (pkemctx->kem != NULL && secret != NULL)
+        oqsx_stats_record(pkemctx->kem->stats, OQSX_OP_DECAPS, start, ret > 0);
+    OQSX_PROBE_RETURN(decaps, OQS_KEM_PROBE_ALG(pkemctx), ret > 0);
     return ret;
 }
 
@@ -375,6 +553,10 @@ static int oqs_hyb_kem_decaps(void *vpkemctx, unsigned char *secret, size_t *sec
       { OSSL_FUNC_KEM_DECAPSULATE_INIT, (void (*)(void))oqs_kem_decaps_init }, \
       { OSSL_FUNC_KEM_DECAPSULATE, (void (*)(void))oqs_hyb_kem_decaps }, \
       { OSSL_FUNC_KEM_FREECTX, (void (*)(void))oqs_kem_freectx }, \
+      { OSSL_FUNC_KEM_GET_CTX_PARAMS, (void (*)(void))oqs_kem_get_ctx_params }, \
+      { OSSL_FUNC_KEM_GETTABLE_CTX_PARAMS, (void (*)(void))oqs_kem_gettable_ctx_params }, \
+      { OSSL_FUNC_KEM_SET_CTX_PARAMS, (void (*)(void))oqs_kem_set_ctx_params }, \
+      { OSSL_FUNC_KEM_SETTABLE_CTX_PARAMS, (void (*)(void))oqs_kem_settable_ctx_params }, \
       { 0, NULL } \
   };
 
@@ -38,15 +38,9 @@ int oqsx_param_build_set_octet_string(OSSL_PARAM_BLD *bld, OSSL_PARAM *p,
 
 
 
-#ifdef NDEBUG
-#define OQS_KM_PRINTF(a)
-#define OQS_KM_PRINTF2(a, b)
-#define OQS_KM_PRINTF3(a, b, c)
-#else
-#define OQS_KM_PRINTF(a) if (getenv("OQSKM")) printf(a)
-#define OQS_KM_PRINTF2(a, b) if (getenv("OQSKM")) printf(a, b)
-#define OQS_KM_PRINTF3(a, b, c) if (getenv("OQSKM")) printf(a, b, c)
-#endif // NDEBUG
+#define OQS_KM_PRINTF(a) OQSX_TRACE(OQSX_TRACE_KM, a)
+#define OQS_KM_PRINTF2(a, b) OQSX_TRACE(OQSX_TRACE_KM, a, b)
+#define OQS_KM_PRINTF3(a, b, c) OQSX_TRACE(OQSX_TRACE_KM, a, b, c)
 
 // our own error codes:
 #define OQSPROV_UNEXPECTED_NULL   1
@@ -66,12 +60,14 @@ static OSSL_FUNC_keymgmt_export_types_fn oqs_imexport_types;
 
 struct oqsx_gen_ctx {
     OSSL_LIB_CTX *libctx;
+    PROV_OQS_CTX *provctx;
     char *propq;
-    char *oqs_name;
+    char *oqs_name; /* one of liboqs' static OQS_*_alg_* names */
     char *tls_name;
     int primitive;
     int selection;
     int bit_security;
+    OQSX_VALIDATION validation;
 };
 
 static int oqsx_has(const void *keydata, int selection)
@@ -148,6 +144,8 @@ static int oqsx_match(const void *keydata1, const void *keydata2, int selection)
     }
 
     if ((selection & OSSL_KEYMGMT_SELECT_PUBLIC_KEY) != 0) {
+        if (!oqsx_key_complete_pubkey(key1) || !oqsx_key_complete_pubkey(key2))
+            return 0;
         if ((key1->pubkey == NULL && key2->pubkey != NULL) ||
             (key1->pubkey != NULL && key2->pubkey == NULL) ||
             ((key1->tls_name!=NULL && key2->tls_name!=NULL) && strcmp(key1->tls_name, key2->tls_name)))
@@ -184,7 +182,7 @@ int oqsx_key_to_params(const OQSX_KEY *key, OSSL_PARAM_BLD *tmpl,
 {
     int ret = 0;
 
-    if (key == NULL)
+    if (key == NULL || !oqsx_key_complete_pubkey(key))
         return 0;
 
     if (key->pubkey != NULL) {
@@ -306,6 +304,10 @@ static int oqsx_get_params(void *key, OSSL_PARAM params[])
     if ((p = OSSL_PARAM_locate(params, OSSL_PKEY_PARAM_MAX_SIZE)) != NULL
         && !OSSL_PARAM_set_int(p, oqsx_key_maxsize(oqsxk)))
         return 0;
+    if ((OSSL_PARAM_locate(params, OSSL_PKEY_PARAM_ENCODED_PUBLIC_KEY) != NULL
+         || OSSL_PARAM_locate(params, OSSL_PKEY_PARAM_PUB_KEY) != NULL)
+        && !oqsx_key_complete_pubkey(oqsxk))
+        return 0;
     if ((p = OSSL_PARAM_locate(params, OSSL_PKEY_PARAM_ENCODED_PUBLIC_KEY)) != NULL) {
         // hybrid KEMs are special in that the classic length information shall not be passed out:
         if (oqsxk->keytype == KEY_TYPE_ECP_HYB_KEM || oqsxk->keytype == KEY_TYPE_ECX_HYB_KEM) {
@@ -371,21 +373,25 @@ static int oqsx_set_params(void *key, const OSSL_PARAM params[])
         int classic_pubkey_len;
         if (oqsxkey->keytype == KEY_TYPE_ECP_HYB_KEM || oqsxkey->keytype == KEY_TYPE_ECX_HYB_KEM) {
             // classic key len already stored by key setup; only data needs to be filled in
-            if (p->data_size != oqsxkey->pubkeylen-SIZE_OF_UINT32
+            if (oqsxkey->comp_pubkey[0] == NULL
+                || p->data_size != oqsxkey->pubkeylen-SIZE_OF_UINT32
                 || !OSSL_PARAM_get_octet_string(p, &oqsxkey->comp_pubkey[0], oqsxkey->pubkeylen-SIZE_OF_UINT32,
                                                 &used_len)) {
                 return 0;
             }
         }
         else {
+            // the key's own buffer, so that the param is not copied to a fresh one
+            oqsx_key_allocate_keymaterial(oqsxkey, 0);
             if (p->data_size != oqsxkey->pubkeylen
                 || !OSSL_PARAM_get_octet_string(p, &oqsxkey->pubkey, oqsxkey->pubkeylen,
                                                 &used_len)) {
                 return 0;
             }
         }
-        OPENSSL_clear_free(oqsxkey->privkey, oqsxkey->privkeylen);
+        oqsx_privkey_free(oqsxkey->privkey, oqsxkey->privkeylen);
         oqsxkey->privkey = NULL;
+        oqsx_key_reset_classical_pkey(oqsxkey);
     }
     p = OSSL_PARAM_locate_const(params, OSSL_PKEY_PARAM_PROPERTIES);
     if (p != NULL) {
@@ -419,11 +425,14 @@ static void *oqsx_gen_init(void *provctx, int selection, char* oqs_name, char* t
 
     if ((gctx = OPENSSL_zalloc(sizeof(*gctx))) != NULL) {
         gctx->libctx = libctx;
-        gctx->oqs_name = OPENSSL_strdup(oqs_name);
+        gctx->provctx = provctx;
+        gctx->oqs_name = oqs_name;
         gctx->tls_name = OPENSSL_strdup(tls_name);
         gctx->primitive = primitive;
         gctx->selection = selection;
         gctx->bit_security = bit_security;
+        gctx->validation = primitive == KEY_TYPE_SIG || primitive == KEY_TYPE_HYB_SIG
+                           ? gctx->provctx->sig_validation : gctx->provctx->kem_validation;
     }
     return gctx;
 }
@@ -435,14 +444,20 @@ static void *oqsx_genkey(struct oqsx_gen_ctx *gctx)
     OQS_KM_PRINTF3("OQSKEYMGMT: gen called for %s (%s)\n", gctx->oqs_name, gctx->tls_name);
     if (gctx == NULL)
         return NULL;
+    // keys with special properties or checks are never pre-generated
+    if (gctx->propq == NULL && gctx->validation == gctx->provctx->kem_validation
+        && (key = oqsx_keypool_get(gctx->provctx->keypool, gctx->oqs_name, gctx->tls_name,
+                                   gctx->primitive, gctx->bit_security)) != NULL)
+        return key;
     if ((key = oqsx_key_new(gctx->libctx, gctx->oqs_name, gctx->tls_name, gctx->primitive, gctx->propq, gctx->bit_security)) == NULL) {
 	OQS_KM_PRINTF2("OQSKM: Error generating key for %s\n", gctx->tls_name);
         ERR_raise(ERR_LIB_USER, ERR_R_MALLOC_FAILURE);
         return NULL;
     }
 
-    if (oqsx_key_gen(key)) {
+    if (oqsx_key_gen(key, gctx->validation)) {
        ERR_raise(ERR_LIB_USER, OQSPROV_UNEXPECTED_NULL);
+       oqsx_key_free(key);
        return NULL;
     }
     return key;
@@ -451,10 +466,18 @@ static void *oqsx_genkey(struct oqsx_gen_ctx *gctx)
 static void *oqsx_gen(void *genctx, OSSL_CALLBACK *osslcb, void *cbarg)
 {
     struct oqsx_gen_ctx *gctx = genctx;
+    uint64_t start = oqsx_stats_now();
+    OQSX_KEY *key;
 
     OQS_KM_PRINTF("OQSKEYMGMT: gen called\n");
+    OQSX_PROBE_ENTRY(keygen, gctx != NULL ? gctx->tls_name : NULL);
 
-    return oqsx_genkey(gctx);
+    key = oqsx_genkey(gctx);
+    if (gctx != NULL)
+        oqsx_stats_record(key != NULL ? key->stats : oqsx_stats_get(gctx->tls_name),
+                          OQSX_OP_KEYGEN, start, key != NULL);
+    OQSX_PROBE_RETURN(keygen, gctx != NULL ? gctx->tls_name : NULL, key != NULL);
+    return key;
 }
 
 static void oqsx_gen_cleanup(void *genctx)
@@ -462,7 +485,6 @@ static void oqsx_gen_cleanup(void *genctx)
     struct oqsx_gen_ctx *gctx = genctx;
 
     OQS_KM_PRINTF("OQSKEYMGMT: gen_cleanup called\n");
-    OPENSSL_free(gctx->oqs_name);
     OPENSSL_free(gctx->tls_name);
     OPENSSL_free(gctx->propq);
     OPENSSL_free(gctx);
@@ -488,6 +510,7 @@ static const OSSL_PARAM *oqsx_gen_settable_params(void *provctx)
     static OSSL_PARAM settable[] = {
         OSSL_PARAM_utf8_string(OSSL_PKEY_PARAM_GROUP_NAME, NULL, 0),
         OSSL_PARAM_utf8_string(OSSL_KDF_PARAM_PROPERTIES, NULL, 0),
+        OSSL_PARAM_utf8_string(OQSPROV_PARAM_KEYGEN_VALIDATION, NULL, 0),
         OSSL_PARAM_END
     };
     return settable;
@@ -518,6 +541,17 @@ static int oqsx_gen_set_params(void *genctx, const OSSL_PARAM params[])
         if (gctx->propq == NULL)
             return 0;
     }
+    p = OSSL_PARAM_locate_const(params, OQSPROV_PARAM_KEYGEN_VALIDATION);
+    if (p != NULL) {
+        int validation;
+
+        if (p->data_type != OSSL_PARAM_UTF8_STRING
+            || (validation = oqsx_validation_from_name(p->data)) < 0) {
+            ERR_raise(ERR_LIB_USER, OQSPROV_R_WRONG_PARAMETERS);
+            return 0;
+        }
+        gctx->validation = validation;
+    }
     return 1;
 }
 
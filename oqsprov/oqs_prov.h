@@ -90,14 +90,97 @@
                         "x448_" #oqsname "")
 #endif
 
+/* worker pool running independent parts of hybrid operations concurrently */
+typedef struct oqsx_thread_pool_st OQSX_THREAD_POOL;
+
+typedef struct oqsx_job_st {
+    int (*fn)(void *arg);
+    void *arg;
+    int ret;
+    int state;
+    struct oqsx_job_st *next;
+} OQSX_JOB;
+
+/* provider configuration keys (see the provider section of openssl.cnf) */
+#define OQSPROV_CONF_HYBRID_PARALLEL "hybrid-parallel"
+#define OQSPROV_CONF_WORKER_THREADS  "worker-threads"
+#define OQSPROV_CONF_KEYGEN_POOL       "keygen-pool"
+#define OQSPROV_CONF_KEYGEN_POOL_DEPTH "keygen-pool-depth"
+#define OQSPROV_CONF_KEYGEN_POOL_LOW   "keygen-pool-low"
+#define OQSPROV_CONF_KEYGEN_POOL_HIGH  "keygen-pool-high"
+#define OQSPROV_CONF_ECDH_POOL_DEPTH   "ecdh-pool-depth"
+#define OQSPROV_CONF_VERIFY_CACHE_SIZE "verify-cache-size"
+#define OQSPROV_CONF_VERIFY_CACHE_TTL  "verify-cache-ttl"
+#define OQSPROV_CONF_KEYGEN_VALIDATION_KEM "keygen-validation-kem"
+#define OQSPROV_CONF_KEYGEN_VALIDATION_SIG "keygen-validation-sig"
+/* ctx parameters overriding the configured default for one operation */
+#define OQSPROV_PARAM_HYBRID_PARALLEL "hybrid-parallel"
+#define OQSPROV_PARAM_KEYGEN_VALIDATION "keygen-validation"
+/* provider parameters */
+#define OQSPROV_PARAM_KEYGEN_POOL_HITS   "keygen-pool-hits"
+#define OQSPROV_PARAM_KEYGEN_POOL_MISSES "keygen-pool-misses"
+#define OQSPROV_PARAM_ECDH_POOL_HITS     "ecdh-pool-hits"
+#define OQSPROV_PARAM_ECDH_POOL_MISSES   "ecdh-pool-misses"
+#define OQSPROV_PARAM_VERIFY_CACHE_HITS   "verify-cache-hits"
+#define OQSPROV_PARAM_VERIFY_CACHE_MISSES "verify-cache-misses"
+#define OQSPROV_PARAM_OP_STATS           "op-stats"
+#define OQSPROV_PARAM_KEYGEN_COUNT       "keygen-count"
+#define OQSPROV_PARAM_SIGN_COUNT         "sign-count"
+#define OQSPROV_PARAM_VERIFY_COUNT       "verify-count"
+#define OQSPROV_PARAM_ENCAPS_COUNT       "encaps-count"
+#define OQSPROV_PARAM_DECAPS_COUNT       "decaps-count"
+#define OQSPROV_PARAM_ENCODE_COUNT       "encode-count"
+#define OQSPROV_PARAM_DECODE_COUNT       "decode-count"
+
+#define OQSPROV_DEFAULT_WORKER_THREADS 2
+#define OQSPROV_DEFAULT_KEYGEN_POOL_DEPTH 8
+#define OQSPROV_DEFAULT_VERIFY_CACHE_TTL 300
+/* KEM keys are mostly ephemeral, signature keys long-term */
+#define OQSPROV_DEFAULT_KEYGEN_VALIDATION_KEM OQSX_VALIDATE_OFF
+#define OQSPROV_DEFAULT_KEYGEN_VALIDATION_SIG OQSX_VALIDATE_CLASSICAL
+
+/* pools of pre-generated KEM and ECDH keys, see oqsprov_keypool.c */
+typedef struct oqsx_keypool_st OQSX_KEYPOOL;
+/* cache of successful signature verifications, see oqsprov_verifycache.c */
+typedef struct oqsx_verify_cache_st OQSX_VERIFY_CACHE;
+/* per-algorithm operation statistics, see oqsprov_stats.c */
+typedef struct oqsx_alg_stats_st OQSX_ALG_STATS;
+typedef enum {
+    OQSX_OP_KEYGEN, OQSX_OP_SIGN, OQSX_OP_VERIFY, OQSX_OP_ENCAPS,
+    OQSX_OP_DECAPS, OQSX_OP_ENCODE, OQSX_OP_DECODE, OQSX_OP_NUM
+} OQSX_OP;
+
+/* checks of freshly generated keys, see oqsx_key_gen() */
+typedef enum {
+    OQSX_VALIDATE_OFF,
+    OQSX_VALIDATE_CLASSICAL,  /* classical half of hybrids re-read from its encoding */
+    OQSX_VALIDATE_FULL        /* also pairwise consistency of both halves */
+} OQSX_VALIDATION;
+
 typedef struct prov_oqs_ctx_st {
     const OSSL_CORE_HANDLE *handle;
     OSSL_LIB_CTX *libctx;         /* For all provider modules */
     BIO_METHOD *corebiometh; 
+    int hybrid_parallel;          /* default for hybrid sign/verify */
+    int worker_threads;
+    OQSX_THREAD_POOL *_Atomic pool; /* started on first use */
+    OQSX_KEYPOOL *keypool;        /* NULL unless configured */
+    OQSX_VERIFY_CACHE *verify_cache; /* NULL unless configured */
+    OQSX_VALIDATION kem_validation;  /* defaults for generated keys */
+    OQSX_VALIDATION sig_validation;
 } PROV_OQS_CTX;
 
 PROV_OQS_CTX *oqsx_newprovctx(OSSL_LIB_CTX *libctx, const OSSL_CORE_HANDLE *handle, BIO_METHOD *bm);
 void oqsx_freeprovctx(PROV_OQS_CTX *ctx);
+
+OQSX_THREAD_POOL *oqsx_thread_pool_new(int nthreads);
+void oqsx_thread_pool_free(OQSX_THREAD_POOL *pool);
+/* queues job; returns 0 if that is not possible and fn has to be run inline */
+int oqsx_thread_pool_submit(OQSX_THREAD_POOL *pool, OQSX_JOB *job,
+                            int (*fn)(void *), void *arg);
+/* waits for a submitted job and returns the result of its fn */
+int oqsx_thread_pool_wait(OQSX_THREAD_POOL *pool, OQSX_JOB *job);
+OQSX_THREAD_POOL *oqsx_provctx_get0_pool(PROV_OQS_CTX *provctx);
 # define PROV_OQS_LIBCTX_OF(provctx) (((PROV_OQS_CTX *)provctx)->libctx)
 
 #include "oqs/oqs.h"
@@ -118,16 +201,16 @@ struct oqsx_evp_info_st {
 typedef struct oqsx_evp_info_st OQSX_EVP_INFO;
 
 struct oqsx_evp_ctx_st {
-    EVP_PKEY_CTX *ctx;
-    EVP_PKEY *keyParam;
+    EVP_PKEY *keyParam; /* shared with the keyParam cache; see oqsx_keyparam_get() */
     const OQSX_EVP_INFO *evp_info;
 };
 
 typedef struct oqsx_evp_ctx_st OQSX_EVP_CTX;
 
+/* shared by all keys of an algorithm; see oqsx_qs_get() */
 typedef union {
-    OQS_SIG *sig;
-    OQS_KEM *kem;
+    const OQS_SIG *sig;
+    const OQS_KEM *kem;
 } OQSX_QS_CTX;
 
 struct oqsx_provider_ctx_st {
@@ -148,7 +231,11 @@ struct oqsx_key_st {
     char *propq;
     OQSX_KEY_TYPE keytype;
     OQSX_PROVIDER_CTX oqsx_provider_ctx;
-    EVP_PKEY *classical_pkey; // for hybrid sigs
+    /* for hybrid sigs; for hybrid KEMs created on first use, see
+     * oqsx_key_get0_classical_pkey() */
+    EVP_PKEY *_Atomic classical_pkey;
+    /* set by decoding a hybrid key until oqsx_key_materialize() ran */
+    _Atomic int classical_deferred;
     const OQSX_EVP_INFO *evp_info;
     size_t numkeys;
 
@@ -157,8 +244,8 @@ struct oqsx_key_st {
     size_t privkeylen;
     size_t pubkeylen;
     size_t bit_security;
-    char *oqs_name;
     char *tls_name;
+    OQSX_ALG_STATS *stats;
     _Atomic int references;
 
     /* point to actual priv key material -- classic key, if present, first
@@ -172,6 +259,8 @@ struct oqsx_key_st {
      */
     void *privkey;
     void *pubkey;
+    /* buffer pubkey points to once set; see oqsx_key_new() */
+    void *pubkey_slab;
 };
 
 typedef struct oqsx_key_st OQSX_KEY;
@@ -179,6 +268,9 @@ typedef struct oqsx_key_st OQSX_KEY;
 /* Register given NID with tlsname in OSSL3 registry */
 int oqs_set_nid(char* tlsname, int nid);
 
+/* TLS name of the OQS signature algorithm with given NID, or NULL */
+const char *oqs_get_tlsname(int nid);
+
 /* Create OQSX_KEY data structure based on parameters; key material allocated separately */ 
 OQSX_KEY *oqsx_key_new(OSSL_LIB_CTX *libctx, char* oqs_name, char* tls_name, int is_kem, const char *propq, int bit_security);
 
@@ -191,8 +283,133 @@ void oqsx_key_free(OQSX_KEY *key);
 /* increase reference count of given key */
 int oqsx_key_up_ref(OQSX_KEY *key);
 
-/* do (composite) key generation */
-int oqsx_key_gen(OQSX_KEY *key);
+/* do (composite) key generation, checking the new key as validation asks for */
+int oqsx_key_gen(OQSX_KEY *key, OQSX_VALIDATION validation);
+
+/* "off", "classical" or "full"; -1 for anything else */
+int oqsx_validation_from_name(const char *name);
+
+/* return classical key of hybrid key (private key for KEMs), creating it once if needed */
+EVP_PKEY *oqsx_key_get0_classical_pkey(OQSX_KEY *key);
+
+/*
+ * parse the classical half of a decoded hybrid key and complete its public
+ * key, once; must precede any use of classical_pkey
+ */
+int oqsx_key_materialize(const OQSX_KEY *key);
+
+/*
+ * complete the public key of a hybrid key decoded from its private key;
+ * must precede any use of the public key
+ */
+int oqsx_key_complete_pubkey(const OQSX_KEY *key);
+
+/* drop cached classical key after key material has been changed */
+void oqsx_key_reset_classical_pkey(OQSX_KEY *key);
+
+/*
+ * pools of pre-generated KEM keys for the algorithms listed in algnames
+ * (may be NULL), checked as validation asks for, and, if ecdh_depth > 0,
+ * of ephemeral keys for each curve
+ */
+OQSX_KEYPOOL *oqsx_keypool_new(OSSL_LIB_CTX *libctx, const char *algnames,
+                               size_t depth, size_t low, size_t high,
+                               size_t ecdh_depth, OQSX_VALIDATION validation);
+void oqsx_keypool_free(OQSX_KEYPOOL *pool);
+/* takes a key off the pool; NULL if the pool is empty or not configured for it */
+OQSX_KEY *oqsx_keypool_get(OQSX_KEYPOOL *pool, const char *oqs_name,
+                           const char *tls_name, int primitive, int bit_security);
+void oqsx_keypool_stats(OQSX_KEYPOOL *pool, size_t *hits, size_t *misses);
+/*
+ * takes an ephemeral key for the curve of keyParam (as returned by
+ * oqsx_keyparam_get) off the pool without locking; NULL if none is left
+ */
+EVP_PKEY *oqsx_keypool_take_ecdh(OQSX_KEYPOOL *pool, EVP_PKEY *keyParam);
+void oqsx_keypool_ecdh_stats(OQSX_KEYPOOL *pool, size_t *hits, size_t *misses);
+
+/* cache of up to size entries, each kept for ttl seconds */
+OQSX_VERIFY_CACHE *oqsx_verify_cache_new(size_t size, size_t ttl);
+void oqsx_verify_cache_free(OQSX_VERIFY_CACHE *cache);
+/* cache key (SHA-256 sized) of a verification of sig over tbs with key */
+int oqsx_verify_cache_hash(const OQSX_KEY *key, const unsigned char *tbs,
+                           size_t tbslen, const unsigned char *sig,
+                           size_t siglen, unsigned char *hash);
+/* 1 if a verification with this cache key succeeded within the TTL */
+int oqsx_verify_cache_lookup(OQSX_VERIFY_CACHE *cache, const unsigned char *hash);
+/* records a successful verification */
+void oqsx_verify_cache_add(OQSX_VERIFY_CACHE *cache, const unsigned char *hash);
+void oqsx_verify_cache_stats(OQSX_VERIFY_CACHE *cache, size_t *hits, size_t *misses);
+
+/*
+ * private key buffers, from secure memory through a per-thread arena, see
+ * oqsprov_arena.c; arenas are used between oqsx_arenas_init() and
+ * oqsx_arenas_free()
+ */
+void *oqsx_privkey_alloc(size_t len);
+void oqsx_privkey_free(void *ptr, size_t len);
+int oqsx_arenas_init(void);
+void oqsx_arenas_free(void);
+
+/*
+ * liboqs randomness from the DRBG of libctx, see oqsprov_rand.c; only the
+ * first library context bound is used, until it is unbound
+ */
+void oqsx_rand_bind(OSSL_LIB_CTX *libctx);
+void oqsx_rand_unbind(OSSL_LIB_CTX *libctx);
+
+/* statistics of the algorithm, created on first use; NULL on failure */
+OQSX_ALG_STATS *oqsx_stats_get(const char *tls_name);
+void oqsx_stats_registry_free(void);
+/* start time of an operation to be passed to oqsx_stats_record() */
+uint64_t oqsx_stats_now(void);
+/* counts an operation started at start; stats may be NULL */
+void oqsx_stats_record(OQSX_ALG_STATS *stats, OQSX_OP op, uint64_t start, int ok);
+/* number of operations of all algorithms */
+size_t oqsx_stats_total(OQSX_OP op);
+/* writes the text report to buf (if not NULL) and returns its full length */
+size_t oqsx_stats_report(char *buf, size_t size);
+
+/*
+ * Debug tracing, see oqsprov_trace.c: categories are enabled once at
+ * provider init, by the OQSSIG, OQSKEM, ... environment variables or the
+ * matching OSSL_trace channel, and cost a flag test when disabled. Release
+ * (NDEBUG) builds compile all trace statements out.
+ */
+#define OQSX_TRACE_SIG  0x01 /* OQSSIG */
+#define OQSX_TRACE_KEM  0x02 /* OQSKEM */
+#define OQSX_TRACE_KM   0x04 /* OQSKM */
+#define OQSX_TRACE_KEY  0x08 /* OQSKEY */
+#define OQSX_TRACE_ENC  0x10 /* OQSENC */
+#define OQSX_TRACE_DEC  0x20 /* OQSDEC */
+#define OQSX_TRACE_PROV 0x40 /* OQSPROV */
+
+extern _Atomic unsigned int oqsx_trace_flags;
+void oqsx_trace_init(void);
+void oqsx_trace_printf(unsigned int category, const char *fmt, ...);
+
+#ifdef NDEBUG
+# define OQSX_TRACE(category, ...)
+#else
+# define OQSX_TRACE(category, ...) \
+    do { \
+        if (atomic_load_explicit(&oqsx_trace_flags, memory_order_relaxed) & (category)) \
+            oqsx_trace_printf(category, __VA_ARGS__); \
+    } while (0)
+#endif // NDEBUG
+
+/*
+ * USDT probes "oqsprovider:<op>_entry(alg)" and "<op>_return(alg, ok)" at
+ * the hot operations, built with -DOQS_PROVIDER_USDT=ON; a nop when not
+ * attached to.
+ */
+#ifdef OQS_PROVIDER_USDT
+# include <sys/sdt.h>
+# define OQSX_PROBE_ENTRY(op, alg) DTRACE_PROBE1(oqsprovider, op##_entry, alg)
+# define OQSX_PROBE_RETURN(op, alg, ok) DTRACE_PROBE2(oqsprovider, op##_return, alg, ok)
+#else
+# define OQSX_PROBE_ENTRY(op, alg)
+# define OQSX_PROBE_RETURN(op, alg, ok)
+#endif
 
 /* create OQSX_KEY from pkcs8 data structure */
 OQSX_KEY *oqsx_key_from_pkcs8(const PKCS8_PRIV_KEY_INFO *p8inf, OSSL_LIB_CTX *libctx, const char *propq);
@@ -219,6 +436,7 @@ extern const OSSL_DISPATCH oqs_generic_kem_functions[];
 extern const OSSL_DISPATCH oqs_hybrid_kem_functions[];
 extern const OSSL_DISPATCH oqs_signature_functions[];
 
+extern const OSSL_DISPATCH oqs_PrivateKeyInfo_der_to_der_decoder_functions[];
 ///// OQS_TEMPLATE_FRAGMENT_ENDECODER_FUNCTIONS_START
 extern const OSSL_DISPATCH oqs_dilithium2_to_PrivateKeyInfo_der_encoder_functions[];
 extern const OSSL_DISPATCH oqs_dilithium2_to_PrivateKeyInfo_pem_encoder_functions[];
@@ -14,6 +14,7 @@
 
 #include "oqs/sig.h"
 
+#include <stdint.h>
 #include <string.h>
 
 #include <openssl/asn1.h>
@@ -26,20 +27,15 @@
 #include <openssl/err.h>
 #include <openssl/x509.h>
 #include "oqs_prov.h"
+#include "oqs_batch.h"
 
 // TBD: Review what we really need/want: For now go with OSSL settings:
 #define OSSL_MAX_NAME_SIZE 50
 #define OSSL_MAX_PROPQUERY_SIZE     256 /* Property query strings */
 
-#ifdef NDEBUG
-#define OQS_SIG_PRINTF(a)
-#define OQS_SIG_PRINTF2(a, b)
-#define OQS_SIG_PRINTF3(a, b, c)
-#else
-#define OQS_SIG_PRINTF(a) if (getenv("OQSSIG")) printf(a)
-#define OQS_SIG_PRINTF2(a, b) if (getenv("OQSSIG")) printf(a, b)
-#define OQS_SIG_PRINTF3(a, b, c) if (getenv("OQSSIG")) printf(a, b, c)
-#endif // NDEBUG
+#define OQS_SIG_PRINTF(a) OQSX_TRACE(OQSX_TRACE_SIG, a)
+#define OQS_SIG_PRINTF2(a, b) OQSX_TRACE(OQSX_TRACE_SIG, a, b)
+#define OQS_SIG_PRINTF3(a, b, c) OQSX_TRACE(OQSX_TRACE_SIG, a, b, c)
 
 static OSSL_FUNC_signature_newctx_fn oqs_sig_newctx;
 static OSSL_FUNC_signature_sign_init_fn oqs_sig_sign_init;
@@ -104,9 +100,104 @@ typedef struct {
     size_t mdsize;
     // for collecting data if no MD is active:
     unsigned char* mddata;
+    size_t mdalloc;
+    /*
+     * Incremental state of the digest signed by the classical half of a
+     * hybrid key; only used if no MD is active, as otherwise the classical
+     * half signs the hash of the (much shorter) main digest.
+     */
+    EVP_MD_CTX *classical_mdctx;
     int operation;
+
+    /* run classical and PQ halves of hybrid signatures concurrently */
+    PROV_OQS_CTX *provctx;
+    int hybrid_parallel;
+    /* classical half of a hybrid key, set up for the operation by init */
+    EVP_PKEY_CTX *classical_ctx;
 } PROV_OQSSIG_CTX;
 
+/* PQ half of a hybrid operation; may be run on a provider worker thread */
+typedef struct {
+    const OQS_SIG *oqs_key;
+    unsigned char *sig;
+    size_t siglen;
+    const unsigned char *tbs;
+    size_t tbslen;
+    const unsigned char *key;
+} OQSX_PQ_SIG_JOB;
+
+static int oqs_sig_pq_sign_job(void *arg)
+{
+    OQSX_PQ_SIG_JOB *job = arg;
+
+    return OQS_SIG_sign(job->oqs_key, job->sig, &job->siglen,
+                        job->tbs, job->tbslen, job->key) == OQS_SUCCESS;
+}
+
+static int oqs_sig_pq_verify_job(void *arg)
+{
+    OQSX_PQ_SIG_JOB *job = arg;
+
+    return OQS_SIG_verify(job->oqs_key, job->tbs, job->tbslen,
+                          job->sig, job->siglen, job->key) == OQS_SUCCESS;
+}
+
+/* returns the pool to use for the PQ half, or NULL to run it inline */
+static OQSX_THREAD_POOL *oqs_sig_parallel_pool(PROV_OQSSIG_CTX *ctx)
+{
+    if (!ctx->hybrid_parallel || ctx->sig->classical_pkey == NULL)
+        return NULL;
+    return oqsx_provctx_get0_pool(ctx->provctx);
+}
+
+/* classical schemes can't sign arbitrarily large data; we hash it first
+ * with a digest matching the NIST level of the PQ algorithm */
+static const EVP_MD *oqs_sig_classical_md(const OQS_SIG *oqs_key)
+{
+    switch (oqs_key->claimed_nist_level) {
+    case 1:
+        return EVP_sha256();
+    case 2:
+    case 3:
+        return EVP_sha384();
+    case 4:
+    case 5:
+    default:
+        return EVP_sha512();
+    }
+}
+
+/* returns a context for the classical half of a hybrid key, ready to
+ * sign or verify digests made with oqs_sig_classical_md() */
+static EVP_PKEY_CTX *oqs_sig_classical_ctx_new(const OQSX_KEY *oqsxkey, int operation)
+{
+    EVP_PKEY_CTX *ctx;
+
+    if ((ctx = EVP_PKEY_CTX_new(oqsxkey->classical_pkey, NULL)) == NULL
+        || (operation == EVP_PKEY_OP_SIGN ? EVP_PKEY_sign_init(ctx)
+                                          : EVP_PKEY_verify_init(ctx)) <= 0
+        || (oqsxkey->evp_info->keytype == EVP_PKEY_RSA
+            && EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PADDING) <= 0)
+        || EVP_PKEY_CTX_set_signature_md(ctx,
+               oqs_sig_classical_md(oqsxkey->oqsx_provider_ctx.oqsx_qs_ctx.sig)) <= 0) {
+        EVP_PKEY_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+/* a copy of the classical context of ctx for use by another thread */
+static EVP_PKEY_CTX *oqs_sig_classical_ctx_dup(const PROV_OQSSIG_CTX *ctx)
+{
+    EVP_PKEY_CTX *cctx;
+
+    if (ctx->classical_ctx == NULL)
+        return NULL;
+    if ((cctx = EVP_PKEY_CTX_dup(ctx->classical_ctx)) == NULL)
+        cctx = oqs_sig_classical_ctx_new(ctx->sig, ctx->operation);
+    return cctx;
+}
+
 static void *oqs_sig_newctx(void *provctx, const char *propq)
 {
     PROV_OQSSIG_CTX *poqs_sigctx;
@@ -118,6 +209,8 @@ static void *oqs_sig_newctx(void *provctx, const char *propq)
         return NULL;
 
     poqs_sigctx->libctx = ((PROV_OQS_CTX*)provctx)->libctx;
+    poqs_sigctx->provctx = provctx;
+    poqs_sigctx->hybrid_parallel = ((PROV_OQS_CTX*)provctx)->hybrid_parallel;
     poqs_sigctx->flag_allow_md = 0;
     if (propq != NULL && (poqs_sigctx->propq = OPENSSL_strdup(propq)) == NULL) {
         OPENSSL_free(poqs_sigctx);
@@ -170,6 +263,11 @@ static int oqs_sig_signverify_init(void *vpoqs_sigctx, void *voqssig, int operat
             || voqssig == NULL
             || !oqsx_key_up_ref(voqssig))
         return 0;
+    // a context re-initialized for the same key and operation keeps its classical context
+    if (poqs_sigctx->sig != voqssig || poqs_sigctx->operation != operation) {
+        EVP_PKEY_CTX_free(poqs_sigctx->classical_ctx);
+        poqs_sigctx->classical_ctx = NULL;
+    }
     oqsx_key_free(poqs_sigctx->sig);
     poqs_sigctx->sig = voqssig;
     poqs_sigctx->operation = operation;
@@ -178,6 +276,18 @@ static int oqs_sig_signverify_init(void *vpoqs_sigctx, void *voqssig, int operat
         ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_KEY);
         return 0;
     }
+    // a decoded hybrid key gets its classical half here, on first use
+    if (poqs_sigctx->sig->keytype == KEY_TYPE_HYB_SIG
+        && oqsx_key_get0_classical_pkey(poqs_sigctx->sig) == NULL) {
+        ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_KEY);
+        return 0;
+    }
+    if (poqs_sigctx->sig->classical_pkey != NULL && poqs_sigctx->classical_ctx == NULL
+        && (poqs_sigctx->classical_ctx
+                = oqs_sig_classical_ctx_new(poqs_sigctx->sig, operation)) == NULL) {
+        ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_KEY);
+        return 0;
+    }
     return 1;
 }
 
@@ -195,16 +305,23 @@ static int oqs_sig_verify_init(void *vpoqs_sigctx, void *voqssig, const OSSL_PAR
 
 /* On entry to this function, data to be signed (tbs) might have been hashed already:
  * this would be the case if poqs_sigctx->mdctx != NULL; if that is NULL, we have to hash
- * in case of hybrid signatures
+ * in case of hybrid signatures, unless the caller already streamed tbs into the
+ * classical digest and passes the result in cdigest.
  */
-static int oqs_sig_sign(void *vpoqs_sigctx, unsigned char *sig, size_t *siglen,
-                    size_t sigsize, const unsigned char *tbs, size_t tbslen)
+static int oqs_sig_sign_internal(PROV_OQSSIG_CTX *poqs_sigctx, unsigned char *sig,
+                                 size_t *siglen, size_t sigsize,
+                                 const unsigned char *tbs, size_t tbslen,
+                                 const unsigned char *cdigest)
 {
-    PROV_OQSSIG_CTX *poqs_sigctx = (PROV_OQSSIG_CTX *)vpoqs_sigctx;
     OQSX_KEY* oqsxkey = poqs_sigctx->sig;
-    OQS_SIG*  oqs_key = poqs_sigctx->sig->oqsx_provider_ctx.oqsx_qs_ctx.sig;
+    const OQS_SIG *oqs_key = poqs_sigctx->sig->oqsx_provider_ctx.oqsx_qs_ctx.sig;
     EVP_PKEY* evpkey = oqsxkey->classical_pkey; // if this value is not NULL, we're running hybrid
-    EVP_PKEY_CTX *classical_ctx_sign = NULL;
+    EVP_PKEY_CTX *cctx = poqs_sigctx->classical_ctx;
+    OQSX_THREAD_POOL *pool = NULL;
+    OQSX_PQ_SIG_JOB pq;
+    OQSX_JOB job;
+    int pq_queued = 0;
+    uint64_t start = oqsx_stats_now();
 
     OQS_SIG_PRINTF2("OQS SIG provider: sign called for %ld bytes\n", tbslen);
 
@@ -233,51 +350,43 @@ static int oqs_sig_sign(void *vpoqs_sigctx, unsigned char *sig, size_t *siglen,
         ERR_raise(ERR_LIB_USER, OQSPROV_R_BUFFER_LENGTH_WRONG);
         return rv;
     }
+    // length queries and argument errors above are not traced
+    OQSX_PROBE_ENTRY(sign, oqsxkey->tls_name);
+
+    pq.oqs_key = oqs_key;
+    pq.siglen = 0;
+    pq.tbs = tbs;
+    pq.tbslen = tbslen;
+    pq.key = oqsxkey->comp_privkey[oqsxkey->numkeys-1];
+    if ((pool = oqs_sig_parallel_pool(poqs_sigctx)) != NULL) {
+        /* the classical signature length is not known yet: let the PQ half
+         * sign behind the longest possible one, and move it down later */
+        pq.sig = sig + SIZE_OF_UINT32 + oqsxkey->evp_info->length_signature;
+        pq_queued = oqsx_thread_pool_submit(pool, &job, oqs_sig_pq_sign_job, &pq);
+    }
 
     if (is_hybrid) {
-        if ((classical_ctx_sign = EVP_PKEY_CTX_new(evpkey, NULL)) == NULL ||
-            EVP_PKEY_sign_init(classical_ctx_sign) <= 0) {
+        if (cctx == NULL) {
           ERR_raise(ERR_LIB_USER, ERR_R_FATAL);
           goto endsign;
         }
-        if (oqsxkey->evp_info->keytype == EVP_PKEY_RSA) {
-            if (EVP_PKEY_CTX_set_rsa_padding(classical_ctx_sign, RSA_PKCS1_PADDING) <= 0) {
-               ERR_raise(ERR_LIB_USER, ERR_R_FATAL);
-               goto endsign;
-            }
-        }
 
 	/* unconditionally hash to be in line with oqs-openssl111:
          * uncomment the following line if using pre-performed hash:
 	 * if (poqs_sigctx->mdctx == NULL) { // hashing not yet done
          */
-          const EVP_MD *classical_md;
-          int digest_len;
+          const EVP_MD *classical_md = oqs_sig_classical_md(oqs_key);
+          int digest_len = EVP_MD_size(classical_md);
           unsigned char digest[SHA512_DIGEST_LENGTH]; /* init with max length */
 
-          /* classical schemes can't sign arbitrarily large data; we hash it first */
-          switch (oqs_key->claimed_nist_level) {
-          case 1:
-            classical_md = EVP_sha256();
-            digest_len = SHA256_DIGEST_LENGTH;
-            SHA256(tbs, tbslen, (unsigned char*) &digest);
-            break;
-          case 2:
-          case 3:
-            classical_md = EVP_sha384();
-            digest_len = SHA384_DIGEST_LENGTH;
-            SHA384(tbs, tbslen, (unsigned char*) &digest);
-            break;
-          case 4:
-          case 5:
-          default:
-            classical_md = EVP_sha512();
-            digest_len = SHA512_DIGEST_LENGTH;
-            SHA512(tbs, tbslen, (unsigned char*) &digest);
-            break;
+          if (cdigest == NULL) {
+            if (!EVP_Digest(tbs, tbslen, digest, NULL, classical_md, NULL)) {
+              ERR_raise(ERR_LIB_USER, ERR_R_FATAL);
+              goto endsign;
+            }
+            cdigest = digest;
           }
-          if ((EVP_PKEY_CTX_set_signature_md(classical_ctx_sign, classical_md) <= 0) ||
-              (EVP_PKEY_sign(classical_ctx_sign, sig + SIZE_OF_UINT32, &actual_classical_sig_len, digest, digest_len) <= 0)) {
+          if (EVP_PKEY_sign(cctx, sig + SIZE_OF_UINT32, &actual_classical_sig_len, cdigest, digest_len) <= 0) {
             ERR_raise(ERR_LIB_USER, ERR_R_FATAL);
             goto endsign;
           }
@@ -300,86 +409,128 @@ static int oqs_sig_sign(void *vpoqs_sigctx, unsigned char *sig, size_t *siglen,
       index += classical_sig_len;
     }
 
-    if (OQS_SIG_sign(oqs_key, sig + index, &oqs_sig_len, tbs, tbslen, oqsxkey->comp_privkey[oqsxkey->numkeys-1]) != OQS_SUCCESS) {
-      ERR_raise(ERR_LIB_USER, OQSPROV_R_SIGNING_FAILED);
-      goto endsign;
+    if (pq_queued) {
+      pq_queued = 0;
+      if (!oqsx_thread_pool_wait(pool, &job)) {
+        ERR_raise(ERR_LIB_USER, OQSPROV_R_SIGNING_FAILED);
+        goto endsign;
+      }
+      memmove(sig + index, pq.sig, pq.siglen);
+    }
+    else {
+      pq.sig = sig + index;
+      if (!oqs_sig_pq_sign_job(&pq)) {
+        ERR_raise(ERR_LIB_USER, OQSPROV_R_SIGNING_FAILED);
+        goto endsign;
+      }
     }
+    oqs_sig_len = pq.siglen;
     *siglen = classical_sig_len + oqs_sig_len;
     OQS_SIG_PRINTF2("OQS SIG provider: signing completes with size %ld\n", *siglen);
     rv = 1; /* success */
 
  endsign:
-    if (classical_ctx_sign) {
-      EVP_PKEY_CTX_free(classical_ctx_sign);
-    }
+    if (pq_queued)
+      oqsx_thread_pool_wait(pool, &job);
+    oqsx_stats_record(oqsxkey->stats, OQSX_OP_SIGN, start, rv);
+    OQSX_PROBE_RETURN(sign, oqsxkey->tls_name, rv);
     return rv;
 }
 
-static int oqs_sig_verify(void *vpoqs_sigctx, const unsigned char *sig, size_t siglen,
-                      const unsigned char *tbs, size_t tbslen)
+static int oqs_sig_sign(void *vpoqs_sigctx, unsigned char *sig, size_t *siglen,
+                    size_t sigsize, const unsigned char *tbs, size_t tbslen)
+{
+    return oqs_sig_sign_internal((PROV_OQSSIG_CTX *)vpoqs_sigctx, sig, siglen,
+                                 sigsize, tbs, tbslen, NULL);
+}
+
+static int oqs_sig_verify_internal(PROV_OQSSIG_CTX *poqs_sigctx,
+                                   const unsigned char *sig, size_t siglen,
+                                   const unsigned char *tbs, size_t tbslen,
+                                   const unsigned char *cdigest)
 {
-    PROV_OQSSIG_CTX *poqs_sigctx = (PROV_OQSSIG_CTX *)vpoqs_sigctx;
     OQSX_KEY* oqsxkey = poqs_sigctx->sig;
-    OQS_SIG*  oqs_key = poqs_sigctx->sig->oqsx_provider_ctx.oqsx_qs_ctx.sig;
+    const OQS_SIG *oqs_key = poqs_sigctx->sig->oqsx_provider_ctx.oqsx_qs_ctx.sig;
     EVP_PKEY* evpkey = oqsxkey->classical_pkey; // if this value is not NULL, we're running hybrid
-    EVP_PKEY_CTX *classical_ctx_sign = NULL;
-    EVP_PKEY_CTX *ctx_verify = NULL;
+    EVP_PKEY_CTX *cctx = poqs_sigctx->classical_ctx;
     int is_hybrid = evpkey!=NULL;
     size_t classical_sig_len = 0;
+    size_t actual_classical_sig_len = 0;
     size_t index = 0;
+    OQSX_THREAD_POOL *pool = NULL;
+    OQSX_PQ_SIG_JOB pq;
+    OQSX_JOB job;
+    OQSX_VERIFY_CACHE *vcache = poqs_sigctx->provctx->verify_cache;
+    unsigned char vhash[SHA256_DIGEST_LENGTH];
+    int pq_queued = 0;
     int rv = 0;
+    uint64_t start = oqsx_stats_now();
 
     OQS_SIG_PRINTF3("OQS SIG provider: verify called with siglen %ld bytes and tbslen %ld\n", siglen, tbslen);
+    OQSX_PROBE_ENTRY(verify, oqsxkey != NULL ? oqsxkey->tls_name : NULL);
 
     if (!oqsxkey || !oqs_key || !oqsxkey->pubkey || sig == NULL || tbs == NULL) {
       ERR_raise(ERR_LIB_USER, OQSPROV_R_WRONG_PARAMETERS);
       goto endverify;
     }
 
-    if (is_hybrid) {
-      const EVP_MD *classical_md;
-      size_t actual_classical_sig_len = 0;
-      int digest_len;
-      unsigned char digest[SHA512_DIGEST_LENGTH]; /* init with max length */
+    if (vcache != NULL) {
+      if (!oqsx_verify_cache_hash(oqsxkey, tbs, tbslen, sig, siglen, vhash))
+        vcache = NULL;
+      else if (oqsx_verify_cache_lookup(vcache, vhash)) {
+        OQS_SIG_PRINTF("OQS SIG provider: verify cache hit\n");
+        rv = 1;
+        goto endverify;
+      }
+    }
 
-      if ((ctx_verify = EVP_PKEY_CTX_new(oqsxkey->classical_pkey, NULL)) == NULL ||
-          EVP_PKEY_verify_init(ctx_verify) <= 0) {
+    if (is_hybrid) {
+      if (siglen < SIZE_OF_UINT32) {
         ERR_raise(ERR_LIB_USER, OQSPROV_R_VERIFY_ERROR);
         goto endverify;
       }
-      if (oqsxkey->evp_info->keytype == EVP_PKEY_RSA) {
-        if (EVP_PKEY_CTX_set_rsa_padding(ctx_verify, RSA_PKCS1_PADDING) <= 0) {
-          ERR_raise(ERR_LIB_USER, OQSPROV_R_WRONG_PARAMETERS);
-          goto endverify;
-        }
-      }
       DECODE_UINT32(actual_classical_sig_len, sig);
+      if (actual_classical_sig_len > siglen - SIZE_OF_UINT32) {
+        ERR_raise(ERR_LIB_USER, OQSPROV_R_VERIFY_ERROR);
+        goto endverify;
+      }
+      classical_sig_len = SIZE_OF_UINT32 + actual_classical_sig_len;
+      index += classical_sig_len;
+    }
 
+    if (!oqsxkey->comp_pubkey[oqsxkey->numkeys-1]) {
+      ERR_raise(ERR_LIB_USER, OQSPROV_R_WRONG_PARAMETERS);
+      goto endverify;
+    }
+    pq.oqs_key = oqs_key;
+    pq.sig = (unsigned char *)sig + index;
+    pq.siglen = siglen - classical_sig_len;
+    pq.tbs = tbs;
+    pq.tbslen = tbslen;
+    pq.key = oqsxkey->comp_pubkey[oqsxkey->numkeys-1];
+    if ((pool = oqs_sig_parallel_pool(poqs_sigctx)) != NULL)
+      pq_queued = oqsx_thread_pool_submit(pool, &job, oqs_sig_pq_verify_job, &pq);
+
+    if (is_hybrid) {
+      const EVP_MD *classical_md = oqs_sig_classical_md(oqs_key);
+      int digest_len = EVP_MD_size(classical_md);
+      unsigned char digest[SHA512_DIGEST_LENGTH]; /* init with max length */
+
+      if (cctx == NULL) {
+        ERR_raise(ERR_LIB_USER, OQSPROV_R_VERIFY_ERROR);
+        goto endverify;
+      }
       /* same as with sign: activate if pre-existing hashing to be used:
        *  if (poqs_sigctx->mdctx == NULL) { // hashing not yet done
        */
-      switch (oqs_key->claimed_nist_level) {
-      case 1:
-        classical_md = EVP_sha256();
-        digest_len = SHA256_DIGEST_LENGTH;
-        SHA256(tbs, tbslen, (unsigned char*) &digest);
-        break;
-      case 2:
-      case 3:
-        classical_md = EVP_sha384();
-        digest_len = SHA384_DIGEST_LENGTH;
-        SHA384(tbs, tbslen, (unsigned char*) &digest);
-        break;
-      case 4:
-      case 5:
-      default:
-        classical_md = EVP_sha512();
-        digest_len = SHA512_DIGEST_LENGTH;
-        SHA512(tbs, tbslen, (unsigned char*) &digest);
-        break;
+      if (cdigest == NULL) {
+        if (!EVP_Digest(tbs, tbslen, digest, NULL, classical_md, NULL)) {
+          ERR_raise(ERR_LIB_USER, OQSPROV_R_VERIFY_ERROR);
+          goto endverify;
+        }
+        cdigest = digest;
       }
-      if ((EVP_PKEY_CTX_set_signature_md(ctx_verify, classical_md) <= 0) ||
-          (EVP_PKEY_verify(ctx_verify, sig + SIZE_OF_UINT32, actual_classical_sig_len, digest, digest_len) <= 0)) {
+      if (EVP_PKEY_verify(cctx, sig + SIZE_OF_UINT32, actual_classical_sig_len, cdigest, digest_len) <= 0) {
         ERR_raise(ERR_LIB_USER, OQSPROV_R_VERIFY_ERROR);
         goto endverify;
       }
@@ -392,27 +543,240 @@ static int oqs_sig_verify(void *vpoqs_sigctx, const unsigned char *sig, size_t s
       *     }
       *  }
       */
-      classical_sig_len = SIZE_OF_UINT32 + actual_classical_sig_len;
-      index += classical_sig_len;
     }
 
-    if (!oqsxkey->comp_pubkey[oqsxkey->numkeys-1]) {
-      ERR_raise(ERR_LIB_USER, OQSPROV_R_WRONG_PARAMETERS);
-      goto endverify;
+    if (pq_queued) {
+      pq_queued = 0;
+      if (!oqsx_thread_pool_wait(pool, &job)) {
+        ERR_raise(ERR_LIB_USER, OQSPROV_R_VERIFY_ERROR);
+        goto endverify;
+      }
     }
-    if (OQS_SIG_verify(oqs_key, tbs, tbslen, sig + index, siglen - classical_sig_len, oqsxkey->comp_pubkey[oqsxkey->numkeys-1]) != OQS_SUCCESS) {
+    else if (!oqs_sig_pq_verify_job(&pq)) {
       ERR_raise(ERR_LIB_USER, OQSPROV_R_VERIFY_ERROR);
       goto endverify;
     }
     rv = 1;
+    if (vcache != NULL)
+      oqsx_verify_cache_add(vcache, vhash);
 
  endverify:
-    if (ctx_verify) {
-      EVP_PKEY_CTX_free(ctx_verify);
-    }
+    if (pq_queued)
+      oqsx_thread_pool_wait(pool, &job);
+    if (oqsxkey != NULL)
+      oqsx_stats_record(oqsxkey->stats, OQSX_OP_VERIFY, start, rv);
+    OQSX_PROBE_RETURN(verify, oqsxkey != NULL ? oqsxkey->tls_name : NULL, rv);
     return rv;
 }
 
+static int oqs_sig_verify(void *vpoqs_sigctx, const unsigned char *sig, size_t siglen,
+                      const unsigned char *tbs, size_t tbslen)
+{
+    return oqs_sig_verify_internal((PROV_OQSSIG_CTX *)vpoqs_sigctx, sig, siglen,
+                                   tbs, tbslen, NULL);
+}
+
+/* a run of consecutive items of a batch operation, see oqs_batch.h */
+typedef struct {
+    /* shallow copy of the caller's context, with its own classical_ctx
+     * unless it is the run of the caller */
+    PROV_OQSSIG_CTX sigctx;
+    void *batch;
+    size_t first, last;
+    size_t ndone;
+    OQSX_JOB job;
+    int queued;
+} OQSX_BATCH_JOB;
+
+static int oqs_sig_batch_verify_job(void *arg)
+{
+    OQSX_BATCH_JOB *bjob = arg;
+    const OQSPROV_BATCH_VERIFY *batch = bjob->batch;
+    EVP_PKEY_CTX *pctx = NULL;
+    EVP_PKEY *pctx_key = NULL;
+    size_t i;
+
+    // failing items are results, not errors
+    ERR_set_mark();
+    for (i = bjob->first; i < bjob->last; i++) {
+        const OQSPROV_BATCH_VERIFY_ITEM *item = &batch->items[i];
+        int ok;
+
+        if (item->key == NULL) {
+            ok = oqs_sig_verify_internal(&bjob->sigctx, item->sig, item->siglen,
+                                         item->tbs, item->tbslen, NULL);
+        } else {
+            // reuse the context as long as items share their key
+            if (item->key != pctx_key) {
+                EVP_PKEY_CTX_free(pctx);
+                pctx_key = item->key;
+                pctx = EVP_PKEY_CTX_new_from_pkey(bjob->sigctx.libctx, item->key,
+                                                  bjob->sigctx.propq);
+                if (pctx != NULL && EVP_PKEY_verify_init(pctx) <= 0) {
+                    EVP_PKEY_CTX_free(pctx);
+                    pctx = NULL;
+                }
+            }
+            ok = pctx != NULL
+                 && EVP_PKEY_verify(pctx, item->sig, item->siglen,
+                                    item->tbs, item->tbslen) == 1;
+        }
+        if (ok) {
+            batch->results[i / 8] |= 1 << (i % 8);
+            bjob->ndone++;
+        }
+    }
+    EVP_PKEY_CTX_free(pctx);
+    ERR_pop_to_mark();
+    return 1;
+}
+
+static int oqs_sig_batch_sign_job(void *arg)
+{
+    OQSX_BATCH_JOB *bjob = arg;
+    OQSPROV_BATCH_SIGN *batch = bjob->batch;
+    size_t i;
+
+    // worker threads have no one to report to: the caller raises the error
+    ERR_set_mark();
+    for (i = bjob->first; i < bjob->last; i++) {
+        OQSPROV_BATCH_SIGN_ITEM *item = &batch->items[i];
+
+        if (oqs_sig_sign_internal(&bjob->sigctx, item->sig, &item->siglen, item->siglen,
+                                  item->tbs, item->tbslen, NULL))
+            bjob->ndone++;
+        else
+            item->siglen = 0;
+    }
+    ERR_pop_to_mark();
+    return 1;
+}
+
+/*
+ * Runs fn on runs of items of a batch, one per worker thread (if parallel)
+ * plus one by the caller. Runs are multiples of align items, so that
+ * results packed into bits of shared bytes are written by one thread only.
+ * Each run other than the caller's uses a copy of the classical context of
+ * a hybrid key for all its items. Returns the number of items fn reported as done in *ndone.
+ */
+static int oqs_sig_batch_run(PROV_OQSSIG_CTX *poqs_sigctx, void *batch, size_t nitems,
+                             size_t align, int parallel, int (*fn)(void *),
+                             size_t *ndone)
+{
+    OQSX_THREAD_POOL *pool = NULL;
+    OQSX_BATCH_JOB *bjobs;
+    size_t nunits, njobs, chunk, i;
+
+    *ndone = 0;
+    if (nitems == 0)
+        return 1;
+
+    nunits = (nitems + align - 1) / align;
+    njobs = 1;
+    if (parallel && nunits > 1
+        && (pool = oqsx_provctx_get0_pool(poqs_sigctx->provctx)) != NULL)
+        njobs = (size_t)poqs_sigctx->provctx->worker_threads + 1;
+    if (njobs > nunits)
+        njobs = nunits;
+    chunk = (nunits + njobs - 1) / njobs * align;
+    njobs = (nitems + chunk - 1) / chunk;
+
+    bjobs = OPENSSL_malloc(njobs * sizeof(*bjobs));
+    if (bjobs == NULL) {
+        ERR_raise(ERR_LIB_USER, ERR_R_MALLOC_FAILURE);
+        return 0;
+    }
+    for (i = 0; i < njobs; i++) {
+        bjobs[i].sigctx = *poqs_sigctx;
+        // workers must not queue the PQ halves of hybrids on their own pool
+        bjobs[i].sigctx.hybrid_parallel = 0;
+        if (i > 0 && poqs_sigctx->classical_ctx != NULL
+            && (bjobs[i].sigctx.classical_ctx
+                    = oqs_sig_classical_ctx_dup(poqs_sigctx)) == NULL) {
+            // leave the remaining items to the previous run
+            njobs = i;
+            bjobs[i - 1].last = nitems;
+            break;
+        }
+        bjobs[i].batch = batch;
+        bjobs[i].first = i * chunk;
+        bjobs[i].last = i + 1 < njobs ? (i + 1) * chunk : nitems;
+        bjobs[i].ndone = 0;
+    }
+    // the caller runs the first run and any that could not be queued
+    for (i = 1; i < njobs; i++)
+        bjobs[i].queued = oqsx_thread_pool_submit(pool, &bjobs[i].job, fn, &bjobs[i]);
+    fn(&bjobs[0]);
+    for (i = 1; i < njobs; i++) {
+        if (bjobs[i].queued)
+            oqsx_thread_pool_wait(pool, &bjobs[i].job);
+        else
+            fn(&bjobs[i]);
+    }
+    for (i = 0; i < njobs; i++) {
+        *ndone += bjobs[i].ndone;
+        if (i > 0)
+            EVP_PKEY_CTX_free(bjobs[i].sigctx.classical_ctx);
+    }
+    OPENSSL_free(bjobs);
+    return 1;
+}
+
+static int oqs_sig_batch_verify(PROV_OQSSIG_CTX *poqs_sigctx,
+                                OQSPROV_BATCH_VERIFY *batch)
+{
+    size_t i;
+
+    if (poqs_sigctx->operation != EVP_PKEY_OP_VERIFY || poqs_sigctx->sig == NULL
+        || (batch->nitems > 0 && (batch->items == NULL || batch->results == NULL))) {
+        ERR_raise(ERR_LIB_USER, OQSPROV_R_WRONG_PARAMETERS);
+        return 0;
+    }
+    for (i = 0; i < batch->nitems; i++) {
+        if (batch->items[i].sig == NULL || batch->items[i].tbs == NULL) {
+            ERR_raise(ERR_LIB_USER, OQSPROV_R_WRONG_PARAMETERS);
+            return 0;
+        }
+    }
+    if (batch->nitems > 0)
+        memset(batch->results, 0, (batch->nitems + 7) / 8);
+    if (!oqs_sig_batch_run(poqs_sigctx, batch, batch->nitems, 8, 1,
+                           oqs_sig_batch_verify_job, &batch->nverified))
+        return 0;
+
+    OQS_SIG_PRINTF3("OQS SIG provider: batch verified %ld of %ld items\n",
+                    batch->nverified, batch->nitems);
+    return 1;
+}
+
+static int oqs_sig_batch_sign(PROV_OQSSIG_CTX *poqs_sigctx, OQSPROV_BATCH_SIGN *batch)
+{
+    size_t i;
+
+    if (poqs_sigctx->operation != EVP_PKEY_OP_SIGN || poqs_sigctx->sig == NULL
+        || (batch->nitems > 0 && batch->items == NULL)) {
+        ERR_raise(ERR_LIB_USER, OQSPROV_R_WRONG_PARAMETERS);
+        return 0;
+    }
+    for (i = 0; i < batch->nitems; i++) {
+        if (batch->items[i].sig == NULL || batch->items[i].tbs == NULL) {
+            ERR_raise(ERR_LIB_USER, OQSPROV_R_WRONG_PARAMETERS);
+            return 0;
+        }
+    }
+    if (!oqs_sig_batch_run(poqs_sigctx, batch, batch->nitems, 1, batch->parallel,
+                           oqs_sig_batch_sign_job, &batch->nsigned))
+        return 0;
+
+    OQS_SIG_PRINTF3("OQS SIG provider: batch signed %ld of %ld items\n",
+                    batch->nsigned, batch->nitems);
+    if (batch->nsigned != batch->nitems) {
+        ERR_raise(ERR_LIB_USER, OQSPROV_R_SIGNING_FAILED);
+        return 0;
+    }
+    return 1;
+}
+
 static int oqs_sig_digest_signverify_init(void *vpoqs_sigctx, const char *mdname,
                                       void *voqssig, int operation)
 {
@@ -427,6 +791,11 @@ static int oqs_sig_digest_signverify_init(void *vpoqs_sigctx, const char *mdname
     if (!oqs_sig_setup_md(poqs_sigctx, mdname, NULL))
         return 0;
 
+    // drop data collected by an earlier operation on this context
+    poqs_sigctx->mdsize = 0;
+    EVP_MD_CTX_free(poqs_sigctx->classical_mdctx);
+    poqs_sigctx->classical_mdctx = NULL;
+
     if (mdname != NULL) {
        poqs_sigctx->mdctx = EVP_MD_CTX_new();
        if (poqs_sigctx->mdctx == NULL)
@@ -435,14 +804,27 @@ static int oqs_sig_digest_signverify_init(void *vpoqs_sigctx, const char *mdname
        if (!EVP_DigestInit_ex(poqs_sigctx->mdctx, poqs_sigctx->md, NULL))
            goto error;
     }
+    else if (poqs_sigctx->sig->classical_pkey != NULL) {
+       // hybrid without MD: stream data into the classical digest right away
+       poqs_sigctx->classical_mdctx = EVP_MD_CTX_new();
+       if (poqs_sigctx->classical_mdctx == NULL)
+           goto error;
+
+       if (!EVP_DigestInit_ex(poqs_sigctx->classical_mdctx,
+                              oqs_sig_classical_md(poqs_sigctx->sig->oqsx_provider_ctx.oqsx_qs_ctx.sig),
+                              NULL))
+           goto error;
+    }
 
     return 1;
 
  error:
     EVP_MD_CTX_free(poqs_sigctx->mdctx);
     EVP_MD_free(poqs_sigctx->md);
+    EVP_MD_CTX_free(poqs_sigctx->classical_mdctx);
     poqs_sigctx->mdctx = NULL;
     poqs_sigctx->md = NULL;
+    poqs_sigctx->classical_mdctx = NULL;
     OQS_SIG_PRINTF("   OQS SIG provider: digest_signverify FAILED\n");
     return 0;
 }
@@ -470,23 +852,35 @@ int oqs_sig_digest_signverify_update(void *vpoqs_sigctx, const unsigned char *da
     if (poqs_sigctx == NULL)
         return 0;
 
-    // unconditionally collect data for passing in full to OQS API
-    if (poqs_sigctx->mddata) {
-	unsigned char* newdata = OPENSSL_realloc(poqs_sigctx->mddata, poqs_sigctx->mdsize+datalen);
-	if (newdata == NULL) return 0;
-	memcpy(newdata+poqs_sigctx->mdsize, data, datalen);
-	poqs_sigctx->mddata = newdata;
-	poqs_sigctx->mdsize += datalen;
-    }
-    else { // simple alloc and copy
-	poqs_sigctx->mddata = OPENSSL_malloc(datalen);
-	if (poqs_sigctx->mddata == NULL) return 0;
-	poqs_sigctx->mdsize=datalen;
-	memcpy(poqs_sigctx->mddata, data, poqs_sigctx->mdsize);
+    // with an active MD only its digest gets signed: no need to keep the data
+    if (poqs_sigctx->mdctx)
+        return EVP_DigestUpdate(poqs_sigctx->mdctx, data, datalen);
+
+    // otherwise collect data for passing in full to OQS API
+    if (datalen > poqs_sigctx->mdalloc - poqs_sigctx->mdsize) {
+        size_t newalloc = poqs_sigctx->mdalloc ? poqs_sigctx->mdalloc : 256;
+        unsigned char* newdata;
+
+        while (newalloc - poqs_sigctx->mdsize < datalen) {
+            if (newalloc > SIZE_MAX / 2) {
+                newalloc = poqs_sigctx->mdsize + datalen;
+                if (newalloc < datalen)
+                    return 0;
+                break;
+            }
+            newalloc *= 2;
+        }
+        newdata = OPENSSL_realloc(poqs_sigctx->mddata, newalloc);
+        if (newdata == NULL)
+            return 0;
+        poqs_sigctx->mddata = newdata;
+        poqs_sigctx->mdalloc = newalloc;
     }
+    memcpy(poqs_sigctx->mddata+poqs_sigctx->mdsize, data, datalen);
+    poqs_sigctx->mdsize += datalen;
     OQS_SIG_PRINTF2("OQS SIG provider: digest_signverify_update collected %ld bytes...\n", poqs_sigctx->mdsize);
-    if (poqs_sigctx->mdctx) 
-    	return EVP_DigestUpdate(poqs_sigctx->mdctx, data, datalen);
+    if (poqs_sigctx->classical_mdctx)
+        return EVP_DigestUpdate(poqs_sigctx->classical_mdctx, data, datalen);
     return 1;
 }
 
@@ -495,6 +889,7 @@ int oqs_sig_digest_sign_final(void *vpoqs_sigctx, unsigned char *sig, size_t *si
 {
     PROV_OQSSIG_CTX *poqs_sigctx = (PROV_OQSSIG_CTX *)vpoqs_sigctx;
     unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned char cdigest[EVP_MAX_MD_SIZE];
     unsigned int dlen = 0;
 
     OQS_SIG_PRINTF("OQS SIG provider: digest_sign_final called\n");
@@ -514,6 +909,9 @@ int oqs_sig_digest_sign_final(void *vpoqs_sigctx, unsigned char *sig, size_t *si
 	if (poqs_sigctx->mdctx != NULL)
         	if (!EVP_DigestFinal_ex(poqs_sigctx->mdctx, digest, &dlen))
             		return 0;
+	if (poqs_sigctx->classical_mdctx != NULL)
+		if (!EVP_DigestFinal_ex(poqs_sigctx->classical_mdctx, cdigest, NULL))
+			return 0;
     }
 
     poqs_sigctx->flag_allow_md = 1;
@@ -521,7 +919,9 @@ int oqs_sig_digest_sign_final(void *vpoqs_sigctx, unsigned char *sig, size_t *si
     if (poqs_sigctx->mdctx != NULL) 
 	return oqs_sig_sign(vpoqs_sigctx, sig, siglen, sigsize, digest, (size_t)dlen);
     else
-	return oqs_sig_sign(vpoqs_sigctx, sig, siglen, sigsize, poqs_sigctx->mddata, poqs_sigctx->mdsize);
+	return oqs_sig_sign_internal(poqs_sigctx, sig, siglen, sigsize,
+			poqs_sigctx->mddata, poqs_sigctx->mdsize,
+			poqs_sigctx->classical_mdctx != NULL ? cdigest : NULL);
 	
 }
 
@@ -546,8 +946,15 @@ int oqs_sig_digest_verify_final(void *vpoqs_sigctx, const unsigned char *sig,
 
     	return oqs_sig_verify(vpoqs_sigctx, sig, siglen, digest, (size_t)dlen);
     }
-    else 
-    	return oqs_sig_verify(vpoqs_sigctx, sig, siglen, poqs_sigctx->mddata, poqs_sigctx->mdsize);
+    else {
+	if (poqs_sigctx->classical_mdctx != NULL)
+		if (!EVP_DigestFinal_ex(poqs_sigctx->classical_mdctx, digest, NULL))
+			return 0;
+
+    	return oqs_sig_verify_internal(poqs_sigctx, sig, siglen,
+			poqs_sigctx->mddata, poqs_sigctx->mdsize,
+			poqs_sigctx->classical_mdctx != NULL ? digest : NULL);
+    }
 }
 
 static void oqs_sig_freectx(void *vpoqs_sigctx)
@@ -565,6 +972,11 @@ static void oqs_sig_freectx(void *vpoqs_sigctx)
     OPENSSL_free(ctx->mddata);
     ctx->mddata = NULL;
     ctx->mdsize = 0;
+    ctx->mdalloc = 0;
+    EVP_MD_CTX_free(ctx->classical_mdctx);
+    ctx->classical_mdctx = NULL;
+    EVP_PKEY_CTX_free(ctx->classical_ctx);
+    ctx->classical_ctx = NULL;
     OPENSSL_free(ctx->aid);
     ctx->aid = NULL;
     ctx->aid_len = 0;
@@ -586,6 +998,12 @@ static void *oqs_sig_dupctx(void *vpoqs_sigctx)
     dstctx->sig = NULL;
     dstctx->md = NULL;
     dstctx->mdctx = NULL;
+    dstctx->mddata = NULL;
+    dstctx->mdalloc = 0;
+    dstctx->classical_mdctx = NULL;
+    dstctx->classical_ctx = NULL;
+    dstctx->aid = NULL;
+    dstctx->propq = NULL;
 
     if (srcctx->sig != NULL && !oqsx_key_up_ref(srcctx->sig))
         goto err;
@@ -602,11 +1020,22 @@ static void *oqs_sig_dupctx(void *vpoqs_sigctx)
             goto err;
     }
 
-    if (srcctx->mddata) {
+    if (srcctx->classical_ctx != NULL
+        && (dstctx->classical_ctx = oqs_sig_classical_ctx_dup(srcctx)) == NULL)
+        goto err;
+
+    if (srcctx->classical_mdctx != NULL) {
+        dstctx->classical_mdctx = EVP_MD_CTX_new();
+        if (dstctx->classical_mdctx == NULL
+                || !EVP_MD_CTX_copy_ex(dstctx->classical_mdctx, srcctx->classical_mdctx))
+            goto err;
+    }
+
+    if (srcctx->mddata && srcctx->mdsize) {
 	dstctx->mddata=OPENSSL_memdup(srcctx->mddata, srcctx->mdsize);
 	if (dstctx->mddata == NULL)
             goto err;
-	dstctx->mdsize = srcctx->mdsize;
+	dstctx->mdalloc = srcctx->mdsize;
     }
 
     if (srcctx->aid) {
@@ -651,12 +1080,17 @@ static int oqs_sig_get_ctx_params(void *vpoqs_sigctx, OSSL_PARAM *params)
     if (p != NULL && !OSSL_PARAM_set_utf8_string(p, poqs_sigctx->mdname))
         return 0;
 
+    p = OSSL_PARAM_locate(params, OQSPROV_PARAM_HYBRID_PARALLEL);
+    if (p != NULL && !OSSL_PARAM_set_int(p, poqs_sigctx->hybrid_parallel))
+        return 0;
+
     return 1;
 }
 
 static const OSSL_PARAM known_gettable_ctx_params[] = {
     OSSL_PARAM_octet_string(OSSL_SIGNATURE_PARAM_ALGORITHM_ID, NULL, 0),
     OSSL_PARAM_utf8_string(OSSL_SIGNATURE_PARAM_DIGEST, NULL, 0),
+    OSSL_PARAM_int(OQSPROV_PARAM_HYBRID_PARALLEL, NULL),
     OSSL_PARAM_END
 };
 
@@ -694,12 +1128,41 @@ static int oqs_sig_set_ctx_params(void *vpoqs_sigctx, const OSSL_PARAM params[])
             return 0;
     }
 
+    p = OSSL_PARAM_locate_const(params, OQSPROV_PARAM_HYBRID_PARALLEL);
+    if (p != NULL && !OSSL_PARAM_get_int(p, &poqs_sigctx->hybrid_parallel))
+        return 0;
+
+    p = OSSL_PARAM_locate_const(params, OQSPROV_PARAM_BATCH_VERIFY);
+    if (p != NULL) {
+        const void *batch = NULL;
+        size_t batchlen = 0;
+
+        if (!OSSL_PARAM_get_octet_ptr(p, &batch, &batchlen)
+            || batch == NULL || batchlen != sizeof(OQSPROV_BATCH_VERIFY)
+            || !oqs_sig_batch_verify(poqs_sigctx, (OQSPROV_BATCH_VERIFY *)batch))
+            return 0;
+    }
+
+    p = OSSL_PARAM_locate_const(params, OQSPROV_PARAM_BATCH_SIGN);
+    if (p != NULL) {
+        const void *batch = NULL;
+        size_t batchlen = 0;
+
+        if (!OSSL_PARAM_get_octet_ptr(p, &batch, &batchlen)
+            || batch == NULL || batchlen != sizeof(OQSPROV_BATCH_SIGN)
+            || !oqs_sig_batch_sign(poqs_sigctx, (OQSPROV_BATCH_SIGN *)batch))
+            return 0;
+    }
+
     return 1;
 }
 
 static const OSSL_PARAM known_settable_ctx_params[] = {
     OSSL_PARAM_utf8_string(OSSL_SIGNATURE_PARAM_DIGEST, NULL, 0),
     OSSL_PARAM_utf8_string(OSSL_SIGNATURE_PARAM_PROPERTIES, NULL, 0),
+    OSSL_PARAM_int(OQSPROV_PARAM_HYBRID_PARALLEL, NULL),
+    OSSL_PARAM_octet_ptr(OQSPROV_PARAM_BATCH_VERIFY, NULL, 0),
+    OSSL_PARAM_octet_ptr(OQSPROV_PARAM_BATCH_SIGN, NULL, 0),
     OSSL_PARAM_END
 };
 
@@ -7,6 +7,7 @@
  *
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <openssl/core.h>
@@ -18,15 +19,9 @@
 #include <openssl/provider.h>
 #include "oqs_prov.h"
 
-#ifdef NDEBUG
-#define OQS_PROV_PRINTF(a)
-#define OQS_PROV_PRINTF2(a, b)
-#define OQS_PROV_PRINTF3(a, b, c)
-#else
-#define OQS_PROV_PRINTF(a) if (getenv("OQSPROV")) printf(a)
-#define OQS_PROV_PRINTF2(a, b) if (getenv("OQSPROV")) printf(a, b)
-#define OQS_PROV_PRINTF3(a, b, c) if (getenv("OQSPROV")) printf(a, b, c)
-#endif // NDEBUG
+#define OQS_PROV_PRINTF(a) OQSX_TRACE(OQSX_TRACE_PROV, a)
+#define OQS_PROV_PRINTF2(a, b) OQSX_TRACE(OQSX_TRACE_PROV, a, b)
+#define OQS_PROV_PRINTF3(a, b, c) OQSX_TRACE(OQSX_TRACE_PROV, a, b, c)
 
 /*
  * Forward declarations to ensure that interface functions are correctly
@@ -143,6 +138,20 @@ static const OSSL_PARAM oqsprovider_param_types[] = {
     OSSL_PARAM_DEFN(OSSL_PROV_PARAM_VERSION, OSSL_PARAM_UTF8_PTR, NULL, 0),
     OSSL_PARAM_DEFN(OSSL_PROV_PARAM_BUILDINFO, OSSL_PARAM_UTF8_PTR, NULL, 0),
     OSSL_PARAM_DEFN(OSSL_PROV_PARAM_STATUS, OSSL_PARAM_INTEGER, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_KEYGEN_POOL_HITS, OSSL_PARAM_UNSIGNED_INTEGER, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_KEYGEN_POOL_MISSES, OSSL_PARAM_UNSIGNED_INTEGER, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_ECDH_POOL_HITS, OSSL_PARAM_UNSIGNED_INTEGER, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_ECDH_POOL_MISSES, OSSL_PARAM_UNSIGNED_INTEGER, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_VERIFY_CACHE_HITS, OSSL_PARAM_UNSIGNED_INTEGER, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_VERIFY_CACHE_MISSES, OSSL_PARAM_UNSIGNED_INTEGER, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_OP_STATS, OSSL_PARAM_UTF8_STRING, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_KEYGEN_COUNT, OSSL_PARAM_UNSIGNED_INTEGER, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_SIGN_COUNT, OSSL_PARAM_UNSIGNED_INTEGER, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_VERIFY_COUNT, OSSL_PARAM_UNSIGNED_INTEGER, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_ENCAPS_COUNT, OSSL_PARAM_UNSIGNED_INTEGER, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_DECAPS_COUNT, OSSL_PARAM_UNSIGNED_INTEGER, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_ENCODE_COUNT, OSSL_PARAM_UNSIGNED_INTEGER, NULL, 0),
+    OSSL_PARAM_DEFN(OQSPROV_PARAM_DECODE_COUNT, OSSL_PARAM_UNSIGNED_INTEGER, NULL, 0),
     OSSL_PARAM_END
 };
 
@@ -407,9 +416,38 @@ static const OSSL_PARAM *oqsprovider_gettable_params(void *provctx)
 
 #define OQS_PROVIDER_BUILD_INFO_STR "OQS Provider v." OQS_PROVIDER_VERSION_STR " based on liboqs v." OQS_VERSION_TEXT
 
+static const struct {
+    const char *param;
+    OQSX_OP op;
+} oqsprovider_op_counts[] = {
+    { OQSPROV_PARAM_KEYGEN_COUNT, OQSX_OP_KEYGEN },
+    { OQSPROV_PARAM_SIGN_COUNT, OQSX_OP_SIGN },
+    { OQSPROV_PARAM_VERIFY_COUNT, OQSX_OP_VERIFY },
+    { OQSPROV_PARAM_ENCAPS_COUNT, OQSX_OP_ENCAPS },
+    { OQSPROV_PARAM_DECAPS_COUNT, OQSX_OP_DECAPS },
+    { OQSPROV_PARAM_ENCODE_COUNT, OQSX_OP_ENCODE },
+    { OQSPROV_PARAM_DECODE_COUNT, OQSX_OP_DECODE },
+};
+
+static int oqsprovider_get_op_stats(OSSL_PARAM *p)
+{
+    size_t len = oqsx_stats_report(NULL, 0);
+    char *report = OPENSSL_malloc(len + 1);
+    int ret;
+
+    if (report == NULL)
+        return 0;
+    // operations completing meanwhile may lengthen it; report what fits
+    oqsx_stats_report(report, len + 1);
+    ret = OSSL_PARAM_set_utf8_string(p, report);
+    OPENSSL_free(report);
+    return ret;
+}
+
 static int oqsprovider_get_params(void *provctx, OSSL_PARAM params[])
 {
     OSSL_PARAM *p;
+    size_t i;
 
     p = OSSL_PARAM_locate(params, OSSL_PROV_PARAM_NAME);
     if (p != NULL && !OSSL_PARAM_set_utf8_ptr(p, "OpenSSL OQS Provider"))
@@ -423,6 +461,39 @@ static int oqsprovider_get_params(void *provctx, OSSL_PARAM params[])
     p = OSSL_PARAM_locate(params, OSSL_PROV_PARAM_STATUS);
     if (p != NULL && !OSSL_PARAM_set_int(p, 1)) // provider is always running
         return 0;
+    p = OSSL_PARAM_locate(params, OQSPROV_PARAM_OP_STATS);
+    if (p != NULL && !oqsprovider_get_op_stats(p))
+        return 0;
+    for (i = 0; i < OSSL_NELEM(oqsprovider_op_counts); i++) {
+        p = OSSL_PARAM_locate(params, oqsprovider_op_counts[i].param);
+        if (p != NULL && !OSSL_PARAM_set_size_t(p, oqsx_stats_total(oqsprovider_op_counts[i].op)))
+            return 0;
+    }
+    if (provctx != NULL) {
+        size_t hits, misses;
+
+        oqsx_keypool_stats(((PROV_OQS_CTX *)provctx)->keypool, &hits, &misses);
+        p = OSSL_PARAM_locate(params, OQSPROV_PARAM_KEYGEN_POOL_HITS);
+        if (p != NULL && !OSSL_PARAM_set_size_t(p, hits))
+            return 0;
+        p = OSSL_PARAM_locate(params, OQSPROV_PARAM_KEYGEN_POOL_MISSES);
+        if (p != NULL && !OSSL_PARAM_set_size_t(p, misses))
+            return 0;
+        oqsx_keypool_ecdh_stats(((PROV_OQS_CTX *)provctx)->keypool, &hits, &misses);
+        p = OSSL_PARAM_locate(params, OQSPROV_PARAM_ECDH_POOL_HITS);
+        if (p != NULL && !OSSL_PARAM_set_size_t(p, hits))
+            return 0;
+        p = OSSL_PARAM_locate(params, OQSPROV_PARAM_ECDH_POOL_MISSES);
+        if (p != NULL && !OSSL_PARAM_set_size_t(p, misses))
+            return 0;
+        oqsx_verify_cache_stats(((PROV_OQS_CTX *)provctx)->verify_cache, &hits, &misses);
+        p = OSSL_PARAM_locate(params, OQSPROV_PARAM_VERIFY_CACHE_HITS);
+        if (p != NULL && !OSSL_PARAM_set_size_t(p, hits))
+            return 0;
+        p = OSSL_PARAM_locate(params, OQSPROV_PARAM_VERIFY_CACHE_MISSES);
+        if (p != NULL && !OSSL_PARAM_set_size_t(p, misses))
+            return 0;
+    }
     return 1;
 }
 
@@ -443,11 +514,96 @@ static const OSSL_ALGORITHM *oqsprovider_query(void *provctx, int operation_id,
     case OSSL_OP_DECODER:
         return oqsprovider_decoder;
     default:
-        if (getenv("OQSPROV")) printf("Unknown operation %d requested from OQS provider\n", operation_id);
+        OQS_PROV_PRINTF2("Unknown operation %d requested from OQS provider\n", operation_id);
     }
     return NULL;
 }
 
+/* reads optional settings from the provider's section in the config file */
+static int oqsprovider_load_config(const OSSL_CORE_HANDLE *handle,
+                                   PROV_OQS_CTX *provctx)
+{
+    char *hybrid_parallel = NULL, *worker_threads = NULL;
+    char *keygen_pool = NULL, *pool_depth = NULL, *pool_low = NULL, *pool_high = NULL;
+    char *ecdh_pool_depth = NULL, *verify_cache_size = NULL, *verify_cache_ttl = NULL;
+    char *kem_validation = NULL, *sig_validation = NULL;
+    size_t depth = OQSPROV_DEFAULT_KEYGEN_POOL_DEPTH, low, high, ecdh_depth = 0;
+    size_t ttl = OQSPROV_DEFAULT_VERIFY_CACHE_TTL;
+    int validation;
+    OSSL_PARAM core_params[12];
+
+    if (c_get_params == NULL)
+        return 1;
+
+    core_params[0] = OSSL_PARAM_construct_utf8_ptr(OQSPROV_CONF_HYBRID_PARALLEL,
+                                                   &hybrid_parallel, 0);
+    core_params[1] = OSSL_PARAM_construct_utf8_ptr(OQSPROV_CONF_WORKER_THREADS,
+                                                   &worker_threads, 0);
+    core_params[2] = OSSL_PARAM_construct_utf8_ptr(OQSPROV_CONF_KEYGEN_POOL,
+                                                   &keygen_pool, 0);
+    core_params[3] = OSSL_PARAM_construct_utf8_ptr(OQSPROV_CONF_KEYGEN_POOL_DEPTH,
+                                                   &pool_depth, 0);
+    core_params[4] = OSSL_PARAM_construct_utf8_ptr(OQSPROV_CONF_KEYGEN_POOL_LOW,
+                                                   &pool_low, 0);
+    core_params[5] = OSSL_PARAM_construct_utf8_ptr(OQSPROV_CONF_KEYGEN_POOL_HIGH,
+                                                   &pool_high, 0);
+    core_params[6] = OSSL_PARAM_construct_utf8_ptr(OQSPROV_CONF_ECDH_POOL_DEPTH,
+                                                   &ecdh_pool_depth, 0);
+    core_params[7] = OSSL_PARAM_construct_utf8_ptr(OQSPROV_CONF_VERIFY_CACHE_SIZE,
+                                                   &verify_cache_size, 0);
+    core_params[8] = OSSL_PARAM_construct_utf8_ptr(OQSPROV_CONF_VERIFY_CACHE_TTL,
+                                                   &verify_cache_ttl, 0);
+    core_params[9] = OSSL_PARAM_construct_utf8_ptr(OQSPROV_CONF_KEYGEN_VALIDATION_KEM,
+                                                   &kem_validation, 0);
+    core_params[10] = OSSL_PARAM_construct_utf8_ptr(OQSPROV_CONF_KEYGEN_VALIDATION_SIG,
+                                                    &sig_validation, 0);
+    core_params[11] = OSSL_PARAM_construct_end();
+    if (!c_get_params(handle, core_params))
+        return 0;
+
+    if (hybrid_parallel != NULL)
+        provctx->hybrid_parallel = atoi(hybrid_parallel) != 0;
+    if (worker_threads != NULL)
+        provctx->worker_threads = atoi(worker_threads);
+    OQS_PROV_PRINTF3("OQS PROV: hybrid_parallel %d, %d worker threads\n",
+                     provctx->hybrid_parallel, provctx->worker_threads);
+
+    if (kem_validation != NULL) {
+        if ((validation = oqsx_validation_from_name(kem_validation)) < 0)
+            return 0;
+        provctx->kem_validation = validation;
+    }
+    if (sig_validation != NULL) {
+        if ((validation = oqsx_validation_from_name(sig_validation)) < 0)
+            return 0;
+        provctx->sig_validation = validation;
+    }
+
+    if (ecdh_pool_depth != NULL && atoi(ecdh_pool_depth) > 0)
+        ecdh_depth = atoi(ecdh_pool_depth);
+    if (keygen_pool != NULL || ecdh_depth > 0) {
+        if (pool_depth != NULL && atoi(pool_depth) > 0)
+            depth = atoi(pool_depth);
+        // by default refill once a quarter of the keys is left
+        low = pool_low != NULL && atoi(pool_low) >= 0 ? (size_t)atoi(pool_low) : depth / 4;
+        high = pool_high != NULL && atoi(pool_high) > 0 ? (size_t)atoi(pool_high) : depth;
+        provctx->keypool = oqsx_keypool_new(provctx->libctx, keygen_pool,
+                                            depth, low, high, ecdh_depth,
+                                            provctx->kem_validation);
+        if (provctx->keypool == NULL)
+            return 0;
+    }
+
+    if (verify_cache_size != NULL && atoi(verify_cache_size) > 0) {
+        if (verify_cache_ttl != NULL && atoi(verify_cache_ttl) > 0)
+            ttl = atoi(verify_cache_ttl);
+        provctx->verify_cache = oqsx_verify_cache_new(atoi(verify_cache_size), ttl);
+        if (provctx->verify_cache == NULL)
+            return 0;
+    }
+    return 1;
+}
+
 static void oqsprovider_teardown(void *provctx)
 {
    oqsx_freeprovctx((PROV_OQS_CTX*)provctx);
@@ -472,10 +628,12 @@ int OSSL_provider_init(const OSSL_CORE_HANDLE *handle,
     OSSL_FUNC_core_obj_create_fn *c_obj_create= NULL;
 
     OSSL_FUNC_core_obj_add_sigid_fn *c_obj_add_sigid= NULL;
-    BIO_METHOD *corebiometh;
+    BIO_METHOD *corebiometh = NULL;
     OSSL_LIB_CTX *libctx = NULL;
     int i, rc = 0;
 
+    oqsx_trace_init();
+
     if (!oqs_prov_bio_from_dispatch(in))
         return 0;
 
@@ -526,6 +684,7 @@ int OSSL_provider_init(const OSSL_CORE_HANDLE *handle,
 
     }
 
+    *provctx = NULL;
     // if libctx not yet existing, create a new one
     if ( ((corebiometh = oqs_bio_prov_init_bio_method()) == NULL) ||
          ((libctx = OSSL_LIB_CTX_new_child(handle, orig_in)) == NULL) ||
@@ -535,6 +694,12 @@ int OSSL_provider_init(const OSSL_CORE_HANDLE *handle,
 	goto end_init;
     }
 
+    if (!oqsprovider_load_config(handle, *provctx)) {
+        OQS_PROV_PRINTF("OQS PROV: error reading provider configuration\n");
+        goto end_init;
+    }
+
+    oqsx_rand_bind(libctx);
     *out = oqsprovider_dispatch_table;
 
     // finally, warn if neither default nor fips provider are present:
@@ -548,8 +713,13 @@ int OSSL_provider_init(const OSSL_CORE_HANDLE *handle,
 
 end_init:
     if (!rc) {
-        OSSL_LIB_CTX_free(libctx);
-        oqsprovider_teardown(*provctx);
+        // a provider context owns libctx and corebiometh once created
+        if (*provctx != NULL)
+            oqsprovider_teardown(*provctx);
+        else {
+            OSSL_LIB_CTX_free(libctx);
+            BIO_meth_free(corebiometh);
+        }
         *provctx = NULL;
     }
     return rc;
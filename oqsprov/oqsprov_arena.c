@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * OQS OpenSSL 3 provider
+ *
+ * Per-thread arenas for private key material. Private keys are held in
+ * secure memory (OPENSSL_secure_zalloc()), and every allocation and free
+ * on OpenSSL's secure heap takes its one global lock. Ephemeral keys, as
+ * made for every TLS key exchange, are freed and allocated again at the
+ * same sizes, so each thread keeps the secure buffers of the keys it frees,
+ * cleansed, in its own arena and hands them out again for keys of the same
+ * length: a thread generating keys of one algorithm then only takes the
+ * lock when its arena is empty. Buffers go to the arena of the thread
+ * freeing them, whichever thread allocated them.
+ *
+ * Arenas are bounded in slots and bytes and released when their thread
+ * exits or with the last provider context. Public keys are not secret and
+ * live in the key's own allocation, see oqsx_key_new().
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include "oqs_prov.h"
+
+#define OQSX_ARENA_SLOTS 16
+#define OQSX_ARENA_MAX_BYTES (64 * 1024)
+
+typedef struct oqsx_arena_st {
+    struct oqsx_arena_st *next;
+    size_t nblocks, bytes;
+    struct {
+        void *ptr;
+        size_t len;
+    } blocks[OQSX_ARENA_SLOTS];
+} OQSX_ARENA;
+
+/* all arenas, the thread exit hook and whether they are in use */
+static pthread_mutex_t oqsx_arenas_lock = PTHREAD_MUTEX_INITIALIZER;
+static OQSX_ARENA *oqsx_arenas = NULL;
+static pthread_key_t oqsx_arena_key;
+static int oqsx_arenas_open = 0;
+/* bumped when all arenas are released, invalidating the threads' pointers */
+static _Atomic unsigned int oqsx_arena_generation = 1;
+
+static _Thread_local OQSX_ARENA *oqsx_thread_arena = NULL;
+static _Thread_local unsigned int oqsx_thread_arena_generation = 0;
+/* set once the thread's arena is released at its exit */
+static _Thread_local int oqsx_thread_exiting = 0;
+
+static void oqsx_arena_release(OQSX_ARENA *arena)
+{
+    size_t i;
+
+    for (i = 0; i < arena->nblocks; i++)
+        OPENSSL_secure_clear_free(arena->blocks[i].ptr, arena->blocks[i].len);
+    OPENSSL_free(arena);
+}
+
+static void oqsx_arena_thread_exit(void *varena)
+{
+    OQSX_ARENA **prev;
+
+    // runs on the exiting thread: keys freed later in its teardown, e.g. by
+    // other thread-specific destructors, bypass the arena
+    oqsx_thread_arena = NULL;
+    oqsx_thread_exiting = 1;
+    pthread_mutex_lock(&oqsx_arenas_lock);
+    for (prev = &oqsx_arenas; *prev != NULL; prev = &(*prev)->next) {
+        if (*prev == varena) {
+            *prev = (*prev)->next;
+            oqsx_arena_release(varena);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&oqsx_arenas_lock);
+}
+
+/*
+ * the arena of the calling thread, created on first use; NULL if none, also
+ * once the thread is exiting
+ */
+static OQSX_ARENA *oqsx_arena_get(void)
+{
+    unsigned int generation = atomic_load_explicit(&oqsx_arena_generation,
+                                                   memory_order_acquire);
+    OQSX_ARENA *arena = NULL;
+
+    if (oqsx_thread_exiting)
+        return NULL;
+    if (oqsx_thread_arena != NULL && oqsx_thread_arena_generation == generation)
+        return oqsx_thread_arena;
+
+    pthread_mutex_lock(&oqsx_arenas_lock);
+    if (oqsx_arenas_open && (arena = OPENSSL_zalloc(sizeof(*arena))) != NULL) {
+        if (pthread_setspecific(oqsx_arena_key, arena) == 0) {
+            arena->next = oqsx_arenas;
+            oqsx_arenas = arena;
+        } else {
+            OPENSSL_free(arena);
+            arena = NULL;
+        }
+    }
+    pthread_mutex_unlock(&oqsx_arenas_lock);
+    if (arena != NULL) {
+        oqsx_thread_arena = arena;
+        oqsx_thread_arena_generation = generation;
+    }
+    return arena;
+}
+
+void *oqsx_privkey_alloc(size_t len)
+{
+    OQSX_ARENA *arena = oqsx_arena_get();
+    void *ptr;
+    size_t i;
+
+    if (arena != NULL) {
+        for (i = arena->nblocks; i-- > 0;) {
+            if (arena->blocks[i].len != len)
+                continue;
+            // already cleansed by oqsx_privkey_free()
+            ptr = arena->blocks[i].ptr;
+            arena->blocks[i] = arena->blocks[--arena->nblocks];
+            arena->bytes -= len;
+            return ptr;
+        }
+    }
+    return OPENSSL_secure_zalloc(len);
+}
+
+void oqsx_privkey_free(void *ptr, size_t len)
+{
+    OQSX_ARENA *arena;
+
+    if (ptr == NULL)
+        return;
+    arena = oqsx_arena_get();
+    if (arena != NULL && arena->nblocks < OQSX_ARENA_SLOTS
+        && arena->bytes + len <= OQSX_ARENA_MAX_BYTES) {
+        OPENSSL_cleanse(ptr, len);
+        arena->blocks[arena->nblocks].ptr = ptr;
+        arena->blocks[arena->nblocks].len = len;
+        arena->nblocks++;
+        arena->bytes += len;
+        return;
+    }
+    OPENSSL_secure_clear_free(ptr, len);
+}
+
+int oqsx_arenas_init(void)
+{
+    int ret = 1;
+
+    pthread_mutex_lock(&oqsx_arenas_lock);
+    if (!oqsx_arenas_open) {
+        ret = pthread_key_create(&oqsx_arena_key, oqsx_arena_thread_exit) == 0;
+        oqsx_arenas_open = ret;
+    }
+    pthread_mutex_unlock(&oqsx_arenas_lock);
+    return ret;
+}
+
+void oqsx_arenas_free(void)
+{
+    OQSX_ARENA *arena;
+
+    pthread_mutex_lock(&oqsx_arenas_lock);
+    if (oqsx_arenas_open) {
+        // no thread exit hooks into this module once it may be unloaded
+        pthread_key_delete(oqsx_arena_key);
+        oqsx_arenas_open = 0;
+    }
+    atomic_fetch_add_explicit(&oqsx_arena_generation, 1, memory_order_acq_rel);
+    while ((arena = oqsx_arenas) != NULL) {
+        oqsx_arenas = arena->next;
+        oqsx_arena_release(arena);
+    }
+    pthread_mutex_unlock(&oqsx_arenas_lock);
+}
@@ -0,0 +1,455 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * OQS OpenSSL 3 provider
+ *
+ * Pools of pre-generated ephemeral keys: a background thread keeps
+ * - the pools of the KEM algorithms listed in the "keygen-pool" config key
+ *   filled, so that key generation (e.g. of a TLS client key share) only
+ *   needs to take a key off the pool, and
+ * - if "ecdh-pool-depth" is set, per-curve pools of the ephemeral classical
+ *   keys used by hybrid encapsulation (e.g. for a TLS server key share).
+ *   These are taken without locking.
+ *
+ * Every pooled key is handed out exactly once. As the keys in the pool
+ * at the time of a fork() are also handed out by the parent, the pool is
+ * not used in a child process.
+ *
+ * The provider may never be torn down (OpenSSL 3.0 keeps providers that
+ * created a child library context alive until exit), so filler threads are
+ * also stopped by an atexit() handler, which runs before libcrypto's own
+ * cleanup as it is registered later.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include "oqs_prov.h"
+
+#define OQS_POOL_PRINTF(a) OQSX_TRACE(OQSX_TRACE_PROV, a)
+#define OQS_POOL_PRINTF2(a, b) OQSX_TRACE(OQSX_TRACE_PROV, a, b)
+
+#define OQSX_KEYPOOL_SEPARATORS ",: \t"
+
+typedef struct {
+    char *tls_name;
+    /* set once the algorithm has been requested for the first time */
+    char *oqs_name;
+    int primitive;
+    int bit_security;
+    int filling;          /* refilling up to the high watermark */
+    size_t count;
+    OQSX_KEY **keys;      /* depth entries */
+} OQSX_KEYPOOL_ALG;
+
+/* P-256, P-384, P-521, X25519, X448, with room to spare */
+#define OQSX_ECDH_POOL_CURVES 8
+
+typedef struct {
+    EVP_PKEY *_Atomic keyParam;   /* curve served; claimed on first use */
+    EVP_PKEY *_Atomic *slots;     /* ecdh_depth entries, NULL if empty */
+    _Atomic int count;            /* may briefly lag behind the slots */
+    _Atomic size_t cursor;
+    _Atomic int filling;
+} OQSX_ECDH_POOL;
+
+struct oqsx_keypool_st {
+    OSSL_LIB_CTX *libctx;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_t thread;
+    int running;
+    int shutdown;
+    pid_t pid;            /* process owning the pool */
+    size_t depth, low, high;
+    OQSX_VALIDATION validation;
+    _Atomic size_t hits, misses;
+    size_t nalgs;
+    OQSX_KEYPOOL_ALG *algs;
+    size_t ecdh_depth, ecdh_low;
+    _Atomic size_t ecdh_hits, ecdh_misses;
+    OQSX_ECDH_POOL ecdh[OQSX_ECDH_POOL_CURVES];
+    struct oqsx_keypool_st *next;   /* in oqsx_keypools */
+};
+
+/* all pools of this process, for stopping their threads at exit */
+static pthread_mutex_t oqsx_keypools_lock = PTHREAD_MUTEX_INITIALIZER;
+static OQSX_KEYPOOL *oqsx_keypools;
+static int oqsx_keypools_atexit;
+
+static int oqsx_keypool_is_kem(int primitive)
+{
+    return primitive == KEY_TYPE_KEM || primitive == KEY_TYPE_ECP_HYB_KEM
+           || primitive == KEY_TYPE_ECX_HYB_KEM;
+}
+
+/* returns the algorithm most in need of keys, or NULL if all are filled */
+static OQSX_KEYPOOL_ALG *oqsx_keypool_next_to_fill(OQSX_KEYPOOL *pool)
+{
+    OQSX_KEYPOOL_ALG *best = NULL;
+    size_t i;
+
+    for (i = 0; i < pool->nalgs; i++) {
+        OQSX_KEYPOOL_ALG *alg = &pool->algs[i];
+
+        if (alg->filling && (best == NULL || alg->count < best->count))
+            best = alg;
+    }
+    return best;
+}
+
+static OQSX_ECDH_POOL *oqsx_keypool_next_ecdh_to_fill(OQSX_KEYPOOL *pool)
+{
+    size_t i;
+
+    for (i = 0; i < OQSX_ECDH_POOL_CURVES; i++)
+        if (atomic_load(&pool->ecdh[i].filling))
+            return &pool->ecdh[i];
+    return NULL;
+}
+
+/* generates one classical key for the curve and puts it into a free slot */
+static void oqsx_keypool_fill_ecdh(OQSX_KEYPOOL *pool, OQSX_ECDH_POOL *curve)
+{
+    EVP_PKEY_CTX *kgctx;
+    EVP_PKEY *pkey = NULL;
+    size_t i;
+
+    if ((kgctx = EVP_PKEY_CTX_new(atomic_load(&curve->keyParam), NULL)) == NULL
+        || EVP_PKEY_keygen_init(kgctx) != 1
+        || EVP_PKEY_keygen(kgctx, &pkey) != 1) {
+        OQS_POOL_PRINTF("OQS PROV: key pool failed to generate ECDH key\n");
+        atomic_store(&curve->filling, 0);
+        goto end;
+    }
+    for (i = 0; i < pool->ecdh_depth && pkey != NULL; i++) {
+        EVP_PKEY *expected = NULL;
+
+        if (atomic_compare_exchange_strong(&curve->slots[i], &expected, pkey))
+            pkey = NULL;
+    }
+    if (pkey != NULL
+        || (size_t)(atomic_fetch_add(&curve->count, 1) + 1) >= pool->ecdh_depth)
+        atomic_store(&curve->filling, 0);
+ end:
+    EVP_PKEY_free(pkey);
+    EVP_PKEY_CTX_free(kgctx);
+}
+
+static void *oqsx_keypool_filler(void *arg)
+{
+    OQSX_KEYPOOL *pool = arg;
+    OQSX_KEYPOOL_ALG *alg;
+    OQSX_ECDH_POOL *curve;
+    OQSX_KEY *key;
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->shutdown) {
+        if ((alg = oqsx_keypool_next_to_fill(pool)) == NULL) {
+            if ((curve = oqsx_keypool_next_ecdh_to_fill(pool)) != NULL) {
+                pthread_mutex_unlock(&pool->lock);
+                oqsx_keypool_fill_ecdh(pool, curve);
+                pthread_mutex_lock(&pool->lock);
+            } else {
+                pthread_cond_wait(&pool->wake, &pool->lock);
+            }
+            continue;
+        }
+        /* the name fields of an algorithm never change once set */
+        pthread_mutex_unlock(&pool->lock);
+        key = oqsx_key_new(pool->libctx, alg->oqs_name, alg->tls_name,
+                           alg->primitive, NULL, alg->bit_security);
+        if (key != NULL && oqsx_key_gen(key, pool->validation)) {
+            oqsx_key_free(key);
+            key = NULL;
+        }
+        pthread_mutex_lock(&pool->lock);
+
+        if (key == NULL) {
+            /* don't spin on persistent errors; retried on next miss */
+            OQS_POOL_PRINTF2("OQS PROV: key pool failed to generate %s\n", alg->tls_name);
+            alg->filling = 0;
+        } else if (alg->count < pool->depth) {
+            alg->keys[alg->count++] = key;
+            if (alg->count >= pool->high)
+                alg->filling = 0;
+        } else {
+            oqsx_key_free(key);
+            alg->filling = 0;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void oqsx_keypool_drop_keys(OQSX_KEYPOOL *pool)
+{
+    size_t i, j;
+
+    for (i = 0; i < pool->nalgs; i++) {
+        while (pool->algs[i].count > 0)
+            oqsx_key_free(pool->algs[i].keys[--pool->algs[i].count]);
+        pool->algs[i].filling = 0;
+    }
+    for (i = 0; i < OQSX_ECDH_POOL_CURVES; i++) {
+        for (j = 0; pool->ecdh[i].slots != NULL && j < pool->ecdh_depth; j++)
+            EVP_PKEY_free(atomic_exchange(&pool->ecdh[i].slots[j], NULL));
+        atomic_store(&pool->ecdh[i].count, 0);
+        atomic_store(&pool->ecdh[i].filling, 0);
+    }
+}
+
+static void oqsx_keypool_release(OQSX_KEYPOOL *pool)
+{
+    size_t i;
+
+    for (i = 0; i < pool->nalgs; i++) {
+        OPENSSL_free(pool->algs[i].tls_name);
+        OPENSSL_free(pool->algs[i].oqs_name);
+        OPENSSL_free(pool->algs[i].keys);
+    }
+    for (i = 0; i < OQSX_ECDH_POOL_CURVES; i++) {
+        EVP_PKEY_free(atomic_load(&pool->ecdh[i].keyParam));
+        OPENSSL_free(pool->ecdh[i].slots);
+    }
+    OPENSSL_free(pool->algs);
+    OPENSSL_free(pool);
+}
+
+/* stops the filler thread for good; the pool can still be taken from */
+static void oqsx_keypool_stop(OQSX_KEYPOOL *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    if (pool->running)
+        pthread_join(pool->thread, NULL);
+    pool->running = 0;
+}
+
+static void oqsx_keypool_stop_all(void)
+{
+    OQSX_KEYPOOL *pool;
+
+    pthread_mutex_lock(&oqsx_keypools_lock);
+    for (pool = oqsx_keypools; pool != NULL; pool = pool->next)
+        if (pool->pid == getpid())
+            oqsx_keypool_stop(pool);
+    pthread_mutex_unlock(&oqsx_keypools_lock);
+}
+
+OQSX_KEYPOOL *oqsx_keypool_new(OSSL_LIB_CTX *libctx, const char *algnames,
+                               size_t depth, size_t low, size_t high,
+                               size_t ecdh_depth, OQSX_VALIDATION validation)
+{
+    OQSX_KEYPOOL *pool;
+    char *names = NULL, *name, *saveptr = NULL;
+    size_t n = 0;
+
+    if ((algnames == NULL || depth == 0) && ecdh_depth == 0)
+        return NULL;
+    if (high == 0 || high > depth)
+        high = depth;
+    if (low >= high)
+        low = high - 1;
+
+    if ((pool = OPENSSL_zalloc(sizeof(*pool))) == NULL)
+        return NULL;
+    pool->libctx = libctx;
+    pool->depth = depth;
+    pool->low = low;
+    pool->high = high;
+    pool->validation = validation;
+    pool->pid = getpid();
+
+    if (algnames != NULL && depth > 0) {
+        if ((names = OPENSSL_strdup(algnames)) == NULL)
+            goto err;
+        for (name = names; *name != '\0'; name++)
+            n += strchr(OQSX_KEYPOOL_SEPARATORS, *name) == NULL
+                 && (name == names || strchr(OQSX_KEYPOOL_SEPARATORS, name[-1]) != NULL);
+        if (n > 0 && (pool->algs = OPENSSL_zalloc(n * sizeof(*pool->algs))) == NULL)
+            goto err;
+
+        for (name = strtok_r(names, OQSX_KEYPOOL_SEPARATORS, &saveptr); name != NULL;
+             name = strtok_r(NULL, OQSX_KEYPOOL_SEPARATORS, &saveptr)) {
+            OQSX_KEYPOOL_ALG *alg = &pool->algs[pool->nalgs++];
+
+            if ((alg->tls_name = OPENSSL_strdup(name)) == NULL
+                || (alg->keys = OPENSSL_zalloc(depth * sizeof(*alg->keys))) == NULL)
+                goto err;
+        }
+        OPENSSL_free(names);
+        names = NULL;
+        OQS_POOL_PRINTF2("OQS PROV: key pool configured for %s\n", algnames);
+    }
+
+    pool->ecdh_depth = ecdh_depth;
+    pool->ecdh_low = ecdh_depth / 4;
+    for (n = 0; ecdh_depth > 0 && n < OQSX_ECDH_POOL_CURVES; n++)
+        if ((pool->ecdh[n].slots = OPENSSL_zalloc(ecdh_depth * sizeof(*pool->ecdh[n].slots))) == NULL)
+            goto err;
+
+    if (pthread_mutex_init(&pool->lock, NULL) != 0)
+        goto err;
+    pthread_cond_init(&pool->wake, NULL);
+
+    pthread_mutex_lock(&oqsx_keypools_lock);
+    if (!oqsx_keypools_atexit)
+        oqsx_keypools_atexit = atexit(oqsx_keypool_stop_all) == 0;
+    pool->next = oqsx_keypools;
+    oqsx_keypools = pool;
+    pthread_mutex_unlock(&oqsx_keypools_lock);
+    return pool;
+
+ err:
+    OPENSSL_free(names);
+    oqsx_keypool_release(pool);
+    return NULL;
+}
+
+void oqsx_keypool_free(OQSX_KEYPOOL *pool)
+{
+    OQSX_KEYPOOL **pp;
+
+    if (pool == NULL)
+        return;
+
+    pthread_mutex_lock(&oqsx_keypools_lock);
+    for (pp = &oqsx_keypools; *pp != NULL; pp = &(*pp)->next) {
+        if (*pp == pool) {
+            *pp = pool->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&oqsx_keypools_lock);
+
+    /* in a forked child, the filler thread is gone and the lock may
+     * have been held at fork time */
+    if (pool->pid == getpid()) {
+        oqsx_keypool_stop(pool);
+        pthread_cond_destroy(&pool->wake);
+        pthread_mutex_destroy(&pool->lock);
+    }
+
+    oqsx_keypool_drop_keys(pool);
+    oqsx_keypool_release(pool);
+}
+
+/* wakes up the filler thread, starting it if needed; called with lock held */
+static void oqsx_keypool_wake_locked(OQSX_KEYPOOL *pool)
+{
+    if (!pool->running && !pool->shutdown)
+        pool->running = pthread_create(&pool->thread, NULL,
+                                       oqsx_keypool_filler, pool) == 0;
+    pthread_cond_signal(&pool->wake);
+}
+
+OQSX_KEY *oqsx_keypool_get(OQSX_KEYPOOL *pool, const char *oqs_name,
+                           const char *tls_name, int primitive, int bit_security)
+{
+    OQSX_KEYPOOL_ALG *alg = NULL;
+    OQSX_KEY *key = NULL;
+    size_t i;
+
+    if (pool == NULL || tls_name == NULL || !oqsx_keypool_is_kem(primitive)
+        || pool->pid != getpid())
+        return NULL;
+    for (i = 0; i < pool->nalgs && alg == NULL; i++)
+        if (strcmp(pool->algs[i].tls_name, tls_name) == 0)
+            alg = &pool->algs[i];
+    if (alg == NULL)
+        return NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (alg->oqs_name == NULL) {
+        alg->oqs_name = OPENSSL_strdup(oqs_name);
+        alg->primitive = primitive;
+        alg->bit_security = bit_security;
+    }
+    if (alg->oqs_name == NULL || strcmp(alg->oqs_name, oqs_name) != 0
+        || alg->primitive != primitive) {
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+    }
+
+    if (alg->count > 0) {
+        key = alg->keys[--alg->count];
+        alg->keys[alg->count] = NULL;
+        atomic_fetch_add(&pool->hits, 1);
+    } else {
+        atomic_fetch_add(&pool->misses, 1);
+    }
+    if (alg->count < pool->low || alg->count == 0) {
+        alg->filling = 1;
+        oqsx_keypool_wake_locked(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return key;
+}
+
+EVP_PKEY *oqsx_keypool_take_ecdh(OQSX_KEYPOOL *pool, EVP_PKEY *keyParam)
+{
+    OQSX_ECDH_POOL *curve = NULL;
+    EVP_PKEY *pkey = NULL;
+    size_t i;
+
+    if (pool == NULL || pool->ecdh_depth == 0 || keyParam == NULL
+        || pool->pid != getpid())
+        return NULL;
+
+    /* keyParam is shared by all keys on a curve, see oqsx_keyparam_get() */
+    for (i = 0; i < OQSX_ECDH_POOL_CURVES && curve == NULL; i++) {
+        EVP_PKEY *cur = atomic_load(&pool->ecdh[i].keyParam);
+
+        if (cur == NULL) {
+            if (!EVP_PKEY_up_ref(keyParam))
+                return NULL;
+            if (!atomic_compare_exchange_strong(&pool->ecdh[i].keyParam, &cur, keyParam))
+                EVP_PKEY_free(keyParam);
+            else
+                cur = keyParam;
+        }
+        if (cur == keyParam)
+            curve = &pool->ecdh[i];
+    }
+    if (curve == NULL)
+        return NULL;
+
+    /* each slot is emptied atomically: no key can be taken twice */
+    for (i = 0; i < pool->ecdh_depth && pkey == NULL
+                && atomic_load(&curve->count) > 0; i++)
+        pkey = atomic_exchange(&curve->slots[atomic_fetch_add(&curve->cursor, 1)
+                                             % pool->ecdh_depth], NULL);
+    if (pkey != NULL) {
+        atomic_fetch_sub(&curve->count, 1);
+        atomic_fetch_add(&pool->ecdh_hits, 1);
+    } else {
+        atomic_fetch_add(&pool->ecdh_misses, 1);
+    }
+
+    if (atomic_load(&curve->count) <= (int)pool->ecdh_low
+        && !atomic_exchange(&curve->filling, 1)) {
+        pthread_mutex_lock(&pool->lock);
+        oqsx_keypool_wake_locked(pool);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return pkey;
+}
+
+void oqsx_keypool_stats(OQSX_KEYPOOL *pool, size_t *hits, size_t *misses)
+{
+    *hits = pool != NULL ? atomic_load(&pool->hits) : 0;
+    *misses = pool != NULL ? atomic_load(&pool->misses) : 0;
+}
+
+void oqsx_keypool_ecdh_stats(OQSX_KEYPOOL *pool, size_t *hits, size_t *misses)
+{
+    *hits = pool != NULL ? atomic_load(&pool->ecdh_hits) : 0;
+    *misses = pool != NULL ? atomic_load(&pool->ecdh_misses) : 0;
+}
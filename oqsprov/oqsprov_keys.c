@@ -13,19 +13,15 @@
 #include <openssl/core_names.h>
 #include <openssl/evp.h>
 #include <openssl/x509.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include "oqs_prov.h"
 
-#ifdef NDEBUG
-#define OQS_KEY_PRINTF(a)
-#define OQS_KEY_PRINTF2(a, b)
-#define OQS_KEY_PRINTF3(a, b, c)
-#else
-#define OQS_KEY_PRINTF(a) if (getenv("OQSKEY")) printf(a)
-#define OQS_KEY_PRINTF2(a, b) if (getenv("OQSKEY")) printf(a, b)
-#define OQS_KEY_PRINTF3(a, b, c) if (getenv("OQSKEY")) printf(a, b, c)
-#endif // NDEBUG
+#define OQS_KEY_PRINTF(a) OQSX_TRACE(OQSX_TRACE_KEY, a)
+#define OQS_KEY_PRINTF2(a, b) OQSX_TRACE(OQSX_TRACE_KEY, a, b)
+#define OQS_KEY_PRINTF3(a, b, c) OQSX_TRACE(OQSX_TRACE_KEY, a, b, c)
 
 typedef enum {
     KEY_OP_PUBLIC,
@@ -46,78 +42,78 @@ typedef struct {
 ///// OQS_TEMPLATE_FRAGMENT_OQSNAMES_START
 #define NID_TABLE_LEN 32
 
+/* sorted by tlsname in strcmp() order for binary search; see generate.py */
 static oqs_nid_name_t nid_names[NID_TABLE_LEN] = {
        { 0, "dilithium2", OQS_SIG_alg_dilithium_2, KEY_TYPE_SIG, 128 },
-       { 0, "p256_dilithium2", OQS_SIG_alg_dilithium_2, KEY_TYPE_HYB_SIG, 128 },
-       { 0, "rsa3072_dilithium2", OQS_SIG_alg_dilithium_2, KEY_TYPE_HYB_SIG, 128 },
-       { 0, "dilithium3", OQS_SIG_alg_dilithium_3, KEY_TYPE_SIG, 192 },
-       { 0, "p384_dilithium3", OQS_SIG_alg_dilithium_3, KEY_TYPE_HYB_SIG, 192 },
-       { 0, "dilithium5", OQS_SIG_alg_dilithium_5, KEY_TYPE_SIG, 256 },
-       { 0, "p521_dilithium5", OQS_SIG_alg_dilithium_5, KEY_TYPE_HYB_SIG, 256 },
        { 0, "dilithium2_aes", OQS_SIG_alg_dilithium_2_aes, KEY_TYPE_SIG, 128 },
-       { 0, "p256_dilithium2_aes", OQS_SIG_alg_dilithium_2_aes, KEY_TYPE_HYB_SIG, 128 },
-       { 0, "rsa3072_dilithium2_aes", OQS_SIG_alg_dilithium_2_aes, KEY_TYPE_HYB_SIG, 128 },
+       { 0, "dilithium3", OQS_SIG_alg_dilithium_3, KEY_TYPE_SIG, 192 },
        { 0, "dilithium3_aes", OQS_SIG_alg_dilithium_3_aes, KEY_TYPE_SIG, 192 },
-       { 0, "p384_dilithium3_aes", OQS_SIG_alg_dilithium_3_aes, KEY_TYPE_HYB_SIG, 192 },
+       { 0, "dilithium5", OQS_SIG_alg_dilithium_5, KEY_TYPE_SIG, 256 },
        { 0, "dilithium5_aes", OQS_SIG_alg_dilithium_5_aes, KEY_TYPE_SIG, 256 },
-       { 0, "p521_dilithium5_aes", OQS_SIG_alg_dilithium_5_aes, KEY_TYPE_HYB_SIG, 256 },
+       { 0, "falcon1024", OQS_SIG_alg_falcon_1024, KEY_TYPE_SIG, 256 },
        { 0, "falcon512", OQS_SIG_alg_falcon_512, KEY_TYPE_SIG, 128 },
+       { 0, "p256_dilithium2", OQS_SIG_alg_dilithium_2, KEY_TYPE_HYB_SIG, 128 },
+       { 0, "p256_dilithium2_aes", OQS_SIG_alg_dilithium_2_aes, KEY_TYPE_HYB_SIG, 128 },
        { 0, "p256_falcon512", OQS_SIG_alg_falcon_512, KEY_TYPE_HYB_SIG, 128 },
-       { 0, "rsa3072_falcon512", OQS_SIG_alg_falcon_512, KEY_TYPE_HYB_SIG, 128 },
-       { 0, "falcon1024", OQS_SIG_alg_falcon_1024, KEY_TYPE_SIG, 256 },
-       { 0, "p521_falcon1024", OQS_SIG_alg_falcon_1024, KEY_TYPE_HYB_SIG, 256 },
-       { 0, "sphincsharaka128frobust", OQS_SIG_alg_sphincs_haraka_128f_robust, KEY_TYPE_SIG, 128 },
        { 0, "p256_sphincsharaka128frobust", OQS_SIG_alg_sphincs_haraka_128f_robust, KEY_TYPE_HYB_SIG, 128 },
-       { 0, "rsa3072_sphincsharaka128frobust", OQS_SIG_alg_sphincs_haraka_128f_robust, KEY_TYPE_HYB_SIG, 128 },
-       { 0, "sphincssha256128frobust", OQS_SIG_alg_sphincs_sha256_128f_robust, KEY_TYPE_SIG, 128 },
        { 0, "p256_sphincssha256128frobust", OQS_SIG_alg_sphincs_sha256_128f_robust, KEY_TYPE_HYB_SIG, 128 },
-       { 0, "rsa3072_sphincssha256128frobust", OQS_SIG_alg_sphincs_sha256_128f_robust, KEY_TYPE_HYB_SIG, 128 },
-       { 0, "sphincsshake256128frobust", OQS_SIG_alg_sphincs_shake256_128f_robust, KEY_TYPE_SIG, 128 },
        { 0, "p256_sphincsshake256128frobust", OQS_SIG_alg_sphincs_shake256_128f_robust, KEY_TYPE_HYB_SIG, 128 },
+       { 0, "p384_dilithium3", OQS_SIG_alg_dilithium_3, KEY_TYPE_HYB_SIG, 192 },
+       { 0, "p384_dilithium3_aes", OQS_SIG_alg_dilithium_3_aes, KEY_TYPE_HYB_SIG, 192 },
+       { 0, "p384_sphincsshake256192fsimple", OQS_SIG_alg_sphincs_shake256_192f_simple, KEY_TYPE_HYB_SIG, 192 },
+       { 0, "p521_dilithium5", OQS_SIG_alg_dilithium_5, KEY_TYPE_HYB_SIG, 256 },
+       { 0, "p521_dilithium5_aes", OQS_SIG_alg_dilithium_5_aes, KEY_TYPE_HYB_SIG, 256 },
+       { 0, "p521_falcon1024", OQS_SIG_alg_falcon_1024, KEY_TYPE_HYB_SIG, 256 },
+       { 0, "p521_sphincsshake256256fsimple", OQS_SIG_alg_sphincs_shake256_256f_simple, KEY_TYPE_HYB_SIG, 256 },
+       { 0, "rsa3072_dilithium2", OQS_SIG_alg_dilithium_2, KEY_TYPE_HYB_SIG, 128 },
+       { 0, "rsa3072_dilithium2_aes", OQS_SIG_alg_dilithium_2_aes, KEY_TYPE_HYB_SIG, 128 },
+       { 0, "rsa3072_falcon512", OQS_SIG_alg_falcon_512, KEY_TYPE_HYB_SIG, 128 },
+       { 0, "rsa3072_sphincsharaka128frobust", OQS_SIG_alg_sphincs_haraka_128f_robust, KEY_TYPE_HYB_SIG, 128 },
+       { 0, "rsa3072_sphincssha256128frobust", OQS_SIG_alg_sphincs_sha256_128f_robust, KEY_TYPE_HYB_SIG, 128 },
        { 0, "rsa3072_sphincsshake256128frobust", OQS_SIG_alg_sphincs_shake256_128f_robust, KEY_TYPE_HYB_SIG, 128 },
+       { 0, "sphincsharaka128frobust", OQS_SIG_alg_sphincs_haraka_128f_robust, KEY_TYPE_SIG, 128 },
+       { 0, "sphincssha256128frobust", OQS_SIG_alg_sphincs_sha256_128f_robust, KEY_TYPE_SIG, 128 },
+       { 0, "sphincsshake256128frobust", OQS_SIG_alg_sphincs_shake256_128f_robust, KEY_TYPE_SIG, 128 },
        { 0, "sphincsshake256192fsimple", OQS_SIG_alg_sphincs_shake256_192f_simple, KEY_TYPE_SIG, 192 },
-       { 0, "p384_sphincsshake256192fsimple", OQS_SIG_alg_sphincs_shake256_192f_simple, KEY_TYPE_HYB_SIG, 192 },
        { 0, "sphincsshake256256fsimple", OQS_SIG_alg_sphincs_shake256_256f_simple, KEY_TYPE_SIG, 256 },
-       { 0, "p521_sphincsshake256256fsimple", OQS_SIG_alg_sphincs_shake256_256f_simple, KEY_TYPE_HYB_SIG, 256 },
 ///// OQS_TEMPLATE_FRAGMENT_OQSNAMES_END
 };
 
+static int oqs_nid_name_cmp(const void *tlsname, const void *entry)
+{
+    return strcmp(tlsname, ((const oqs_nid_name_t *)entry)->tlsname);
+}
+
+static oqs_nid_name_t *oqs_find_tlsname(const char *tlsname)
+{
+    return bsearch(tlsname, nid_names, NID_TABLE_LEN, sizeof(nid_names[0]),
+                   oqs_nid_name_cmp);
+}
+
 int oqs_set_nid(char* tlsname, int nid) {
-   int i;
-   for(i=0;i<NID_TABLE_LEN;i++) {
-      if (!strcmp(nid_names[i].tlsname, tlsname)) {
-          nid_names[i].nid = nid;
-          return 1;
-      }
-   }
-   return 0;
-}
-
-static int get_secbits(int nid) {
-   int i;
-   for(i=0;i<NID_TABLE_LEN;i++) {
-      if (nid_names[i].nid == nid)
-          return nid_names[i].secbits;
-   }
-   return 0; 
-}
-
-static int get_keytype(int nid) {
-   int i;
-   for(i=0;i<NID_TABLE_LEN;i++) {
-      if (nid_names[i].nid == nid)
-          return nid_names[i].keytype;
-   }
-   return 0; 
-}
-
-static char* get_oqsname(int nid) {
-   int i;
-   for(i=0;i<NID_TABLE_LEN;i++) {
-      if (nid_names[i].nid == nid)
-          return nid_names[i].oqsname;
-   }
-   return 0; 
+   oqs_nid_name_t *entry = oqs_find_tlsname(tlsname);
+
+   if (entry == NULL)
+      return 0;
+   entry->nid = nid;
+   return 1;
+}
+
+/* NIDs are only known at run time: look their entry up by short name */
+static const oqs_nid_name_t *oqs_find_nid(int nid) {
+   const char *tlsname = OBJ_nid2sn(nid);
+   const oqs_nid_name_t *entry;
+
+   if (tlsname == NULL || (entry = oqs_find_tlsname(tlsname)) == NULL
+       || entry->nid != nid)
+      return NULL;
+   return entry;
+}
+
+const char *oqs_get_tlsname(int nid) {
+   const oqs_nid_name_t *entry = oqs_find_nid(nid);
+
+   return entry != NULL ? entry->tlsname : NULL;
 }
 
 static int oqsx_key_set_composites(OQSX_KEY *key) {
@@ -153,20 +149,223 @@ static int oqsx_key_set_composites(OQSX_KEY *key) {
 	return ret;
 }
 
+/*
+ * Process-wide cache of classical key parameters, one immutable EVP_PKEY
+ * per curve. Entries get created on first use, installed lock-free and
+ * shared by reference (EVP_PKEY_up_ref) by all hybrid keys using that curve.
+ * They are released when the last provider context goes away.
+ */
+enum {
+    KEYPARAM_P256,
+    KEYPARAM_P384,
+    KEYPARAM_P521,
+    KEYPARAM_X25519,
+    KEYPARAM_X448,
+    KEYPARAM_CACHE_LEN
+};
+
+static EVP_PKEY *_Atomic oqsx_keyparam_cache[KEYPARAM_CACHE_LEN];
+static _Atomic int oqsx_provctx_count;
+
+static int oqsx_keyparam_idx(const OQSX_EVP_INFO *evp_info)
+{
+    switch (evp_info->keytype) {
+    case EVP_PKEY_EC:
+        switch (evp_info->nid) {
+        case NID_X9_62_prime256v1: return KEYPARAM_P256;
+        case NID_secp384r1: return KEYPARAM_P384;
+        case NID_secp521r1: return KEYPARAM_P521;
+        default: return -1;
+        }
+    case EVP_PKEY_X25519: return KEYPARAM_X25519;
+    case EVP_PKEY_X448: return KEYPARAM_X448;
+    default: return -1;
+    }
+}
+
+static EVP_PKEY *oqsx_keyparam_create(const OQSX_EVP_INFO *evp_info)
+{
+    EVP_PKEY_CTX *pctx = NULL;
+    EVP_PKEY *keyParam = NULL;
+
+    if (evp_info->keytype == EVP_PKEY_EC) {
+        pctx = EVP_PKEY_CTX_new_id(evp_info->keytype, NULL);
+        ON_ERR_GOTO(!pctx, err);
+        ON_ERR_GOTO(EVP_PKEY_paramgen_init(pctx) <= 0, err);
+        ON_ERR_GOTO(EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pctx, evp_info->nid) <= 0, err);
+        ON_ERR_GOTO(EVP_PKEY_paramgen(pctx, &keyParam) <= 0, err);
+    } else {
+        keyParam = EVP_PKEY_new();
+        ON_ERR_GOTO(!keyParam, err);
+        ON_ERR_GOTO(EVP_PKEY_set_type(keyParam, evp_info->keytype) <= 0, err);
+    }
+    EVP_PKEY_CTX_free(pctx);
+    return keyParam;
+
+    err:
+    EVP_PKEY_CTX_free(pctx);
+    EVP_PKEY_free(keyParam);
+    return NULL;
+}
+
+/* returns a new reference to the cached parameters for evp_info's curve */
+static EVP_PKEY *oqsx_keyparam_get(const OQSX_EVP_INFO *evp_info)
+{
+    EVP_PKEY *cached, *fresh;
+    int idx = oqsx_keyparam_idx(evp_info);
+
+    if (idx < 0)
+        return NULL;
+
+    cached = atomic_load_explicit(&oqsx_keyparam_cache[idx], memory_order_acquire);
+    if (cached == NULL) {
+        fresh = oqsx_keyparam_create(evp_info);
+        if (fresh == NULL)
+            return NULL;
+        if (atomic_compare_exchange_strong_explicit(&oqsx_keyparam_cache[idx],
+                                                    &cached, fresh,
+                                                    memory_order_acq_rel,
+                                                    memory_order_acquire)) {
+            cached = fresh;
+        } else {
+            // another thread won the race: use its entry
+            EVP_PKEY_free(fresh);
+        }
+    }
+    if (!EVP_PKEY_up_ref(cached))
+        return NULL;
+    return cached;
+}
+
+static void oqsx_keyparam_cache_free(void)
+{
+    int i;
+
+    for (i = 0; i < KEYPARAM_CACHE_LEN; i++)
+        EVP_PKEY_free(atomic_exchange(&oqsx_keyparam_cache[i], NULL));
+}
+
+/*
+ * Process-wide registry of liboqs algorithm descriptors. OQS_SIG and OQS_KEM
+ * objects only describe an algorithm, so one per algorithm is created on
+ * first use and shared read-only by all keys. Entries live in an
+ * open-addressing hash table keyed by liboqs name, are installed lock-free
+ * and, like the keyParam cache, released with the last provider context.
+ */
+#define QS_REGISTRY_LEN 256 /* power of 2, well above the number of algorithms */
+
+typedef struct {
+    int is_kem;
+    OQSX_QS_CTX desc;
+    char name[];
+} OQSX_QS_ENTRY;
+
+static OQSX_QS_ENTRY *_Atomic oqsx_qs_registry[QS_REGISTRY_LEN];
+
+static size_t oqsx_qs_hash(const char *name)
+{
+    size_t h = 2166136261u; /* FNV-1a */
+
+    while (*name != '\0')
+        h = (h ^ (unsigned char)*name++) * 16777619u;
+    return h;
+}
+
+static void oqsx_qs_entry_free(OQSX_QS_ENTRY *entry)
+{
+    if (entry == NULL)
+        return;
+    if (entry->is_kem)
+        OQS_KEM_free((OQS_KEM *)entry->desc.kem);
+    else
+        OQS_SIG_free((OQS_SIG *)entry->desc.sig);
+    OPENSSL_free(entry);
+}
+
+static OQSX_QS_ENTRY *oqsx_qs_entry_new(const char *oqs_name, int is_kem)
+{
+    size_t namelen = strlen(oqs_name) + 1;
+    OQSX_QS_ENTRY *entry = OPENSSL_malloc(sizeof(*entry) + namelen);
+
+    if (entry == NULL)
+        return NULL;
+    entry->is_kem = is_kem;
+    memcpy(entry->name, oqs_name, namelen);
+    if (is_kem ? (entry->desc.kem = OQS_KEM_new(oqs_name)) == NULL
+               : (entry->desc.sig = OQS_SIG_new(oqs_name)) == NULL) {
+        OPENSSL_free(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+/* returns the shared descriptor of a liboqs algorithm; NULL if not enabled */
+static OQSX_QS_CTX oqsx_qs_get(const char *oqs_name, int is_kem)
+{
+    OQSX_QS_CTX none = { NULL };
+    OQSX_QS_ENTRY *entry, *fresh = NULL;
+    size_t i, n;
+
+    i = oqsx_qs_hash(oqs_name);
+    for (n = 0; n < QS_REGISTRY_LEN; n++, i++) {
+        _Atomic(OQSX_QS_ENTRY *) *slot = &oqsx_qs_registry[i & (QS_REGISTRY_LEN - 1)];
+
+        entry = atomic_load_explicit(slot, memory_order_acquire);
+        if (entry == NULL) {
+            if (fresh == NULL && (fresh = oqsx_qs_entry_new(oqs_name, is_kem)) == NULL)
+                return none;
+            if (atomic_compare_exchange_strong_explicit(slot, &entry, fresh,
+                                                        memory_order_acq_rel,
+                                                        memory_order_acquire))
+                return fresh->desc;
+            // another thread took the slot: it may have added the same entry
+        }
+        if (entry->is_kem == is_kem && strcmp(entry->name, oqs_name) == 0) {
+            oqsx_qs_entry_free(fresh);
+            return entry->desc;
+        }
+    }
+    oqsx_qs_entry_free(fresh);
+    return none;
+}
+
+static void oqsx_qs_registry_free(void)
+{
+    int i;
+
+    for (i = 0; i < QS_REGISTRY_LEN; i++)
+        oqsx_qs_entry_free(atomic_exchange(&oqsx_qs_registry[i], NULL));
+}
+
 PROV_OQS_CTX *oqsx_newprovctx(OSSL_LIB_CTX *libctx, const OSSL_CORE_HANDLE *handle, BIO_METHOD *bm) {
     PROV_OQS_CTX * ret = OPENSSL_zalloc(sizeof(PROV_OQS_CTX));
     if (ret) {
        ret->libctx = libctx;
        ret->handle = handle;
        ret->corebiometh = bm;
+       ret->worker_threads = OQSPROV_DEFAULT_WORKER_THREADS;
+       ret->kem_validation = OQSPROV_DEFAULT_KEYGEN_VALIDATION_KEM;
+       ret->sig_validation = OQSPROV_DEFAULT_KEYGEN_VALIDATION_SIG;
+       if (atomic_fetch_add(&oqsx_provctx_count, 1) == 0)
+           oqsx_arenas_init();
     }
     return ret;
 }
 
 void oqsx_freeprovctx(PROV_OQS_CTX *ctx) {
+    oqsx_thread_pool_free(atomic_load(&ctx->pool));
+    oqsx_keypool_free(ctx->keypool);
+    oqsx_verify_cache_free(ctx->verify_cache);
+    oqsx_rand_unbind(ctx->libctx);
     OSSL_LIB_CTX_free(ctx->libctx);
     BIO_meth_free(ctx->corebiometh);
     OPENSSL_free(ctx);
+    if (atomic_fetch_sub(&oqsx_provctx_count, 1) == 1) {
+        oqsx_keyparam_cache_free();
+        oqsx_qs_registry_free();
+        oqsx_stats_registry_free();
+        oqsx_arenas_free();
+    }
 }
 
 
@@ -179,15 +378,15 @@ void oqsx_key_set0_libctx(OQSX_KEY *key, OSSL_LIB_CTX *libctx)
 static OQSX_KEY *oqsx_key_new_from_nid(OSSL_LIB_CTX *libctx, const char *propq, int nid) {
 	OQS_KEY_PRINTF2("Generating OQSX key for nid %d\n", nid);
 
-	char* tls_algname = (char *)OBJ_nid2sn(nid);
-	OQS_KEY_PRINTF2("                    for tls_name %s\n", tls_algname);
+	const oqs_nid_name_t *entry = oqs_find_nid(nid);
 
-	if (!tls_algname) {
+	if (!entry) {
 		ERR_raise(ERR_LIB_USER, OQSPROV_R_WRONG_PARAMETERS);
 		return NULL;
 	}
+	OQS_KEY_PRINTF2("                    for tls_name %s\n", entry->tlsname);
 
-	return oqsx_key_new(libctx, get_oqsname(nid), tls_algname, get_keytype(nid), propq, get_secbits(nid));
+	return oqsx_key_new(libctx, entry->oqsname, entry->tlsname, entry->keytype, propq, entry->secbits);
 }
 
 /* Workaround for not functioning EC PARAM initialization
@@ -314,54 +513,16 @@ static OQSX_KEY *oqsx_key_op(const X509_ALGOR *palg,
     ret = oqsx_key_set_composites(key);
     ON_ERR_GOTO(ret, err);
     if (key->numkeys == 2) { // hybrid key
-        int classical_pubkey_len, classical_privkey_len;
         if (!key->evp_info) {
             ERR_raise(ERR_LIB_USER, OQSPROV_R_EVPINFO_MISSING);
             goto err;
         }
-	if (op == KEY_OP_PUBLIC) {
-            DECODE_UINT32(classical_pubkey_len, key->pubkey);
-            if (key->evp_info->raw_key_support) {
-                ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_ENCODING);
-                goto err;
-            }
-            else {
-                const unsigned char* enc_pubkey = key->comp_pubkey[0];
-                EVP_PKEY* npk = EVP_PKEY_new();
-                if (key->evp_info->keytype != EVP_PKEY_RSA) {
-                    npk = setECParams(npk, key->evp_info->nid);
-                }
-                key->classical_pkey = d2i_PublicKey(key->evp_info->keytype, &npk, &enc_pubkey, classical_pubkey_len);
-                if (!key->classical_pkey) {
-                    ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_ENCODING);
-                    goto err;
-                }
-            }
-        }
-	if (op == KEY_OP_PRIVATE) {
-            DECODE_UINT32(classical_privkey_len, key->privkey);
-            if (key->evp_info->raw_key_support) {
-                ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_ENCODING);
-                goto err;
-            }
-            else {
-                const unsigned char* enc_privkey = key->comp_privkey[0];
-                unsigned char* enc_pubkey = key->comp_pubkey[0];
-                key->classical_pkey = d2i_PrivateKey(key->evp_info->keytype, NULL, &enc_privkey, classical_privkey_len);
-                if (!key->classical_pkey) {
-                    ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_ENCODING);
-                    goto err;
-                }
-#ifndef NOPUBKEY_IN_PRIVKEY
-		// re-create classic public key part from private key:
-		int pubkeylen = i2d_PublicKey(key->classical_pkey, &enc_pubkey);
-		if (pubkeylen != key->evp_info->length_public_key) {
-                    ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_ENCODING);
-                    goto err;
-                }
-#endif
-            }
+        if (key->evp_info->raw_key_support) {
+            ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_ENCODING);
+            goto err;
         }
+        // parsed on first use, see oqsx_key_materialize()
+        key->classical_deferred = 1;
     }
 
     return key;
@@ -451,18 +612,9 @@ static int oqsx_hybsig_init(int bit_security, OQSX_EVP_CTX *evp_ctx, char* algna
 
     evp_ctx->evp_info = &nids_sig[idx];
 
-    evp_ctx->ctx = EVP_PKEY_CTX_new_id(evp_ctx->evp_info->keytype, NULL);
-    ON_ERR_GOTO(!evp_ctx->ctx, err);
-
     if (idx < 3) { // EC
-	ret = EVP_PKEY_paramgen_init(evp_ctx->ctx);
-	ON_ERR_GOTO(ret <= 0, err);
-
-        ret = EVP_PKEY_CTX_set_ec_paramgen_curve_nid(evp_ctx->ctx, evp_ctx->evp_info->nid);
-	ON_ERR_GOTO(ret <= 0, err);
-
-	ret = EVP_PKEY_paramgen(evp_ctx->ctx, &evp_ctx->keyParam);
-	ON_ERR_GOTO(ret <= 0 || !evp_ctx->keyParam, err);
+        evp_ctx->keyParam = oqsx_keyparam_get(evp_ctx->evp_info);
+        ON_ERR_SET_GOTO(!evp_ctx->keyParam, ret, 0, err);
     }
     // RSA bit length set only during keygen
 
@@ -478,17 +630,8 @@ static const int oqshybkem_init_ecp(int bit_security, OQSX_EVP_CTX *evp_ctx)
 
     evp_ctx->evp_info = &nids_ecp[idx];
 
-    evp_ctx->ctx = EVP_PKEY_CTX_new_id(evp_ctx->evp_info->keytype, NULL);
-    ON_ERR_GOTO(!evp_ctx->ctx, err);
-
-    ret = EVP_PKEY_paramgen_init(evp_ctx->ctx);
-    ON_ERR_GOTO(ret <= 0, err);
-
-    ret = EVP_PKEY_CTX_set_ec_paramgen_curve_nid(evp_ctx->ctx, evp_ctx->evp_info->nid);
-    ON_ERR_GOTO(ret <= 0, err);
-
-    ret = EVP_PKEY_paramgen(evp_ctx->ctx, &evp_ctx->keyParam);
-    ON_ERR_GOTO(ret <= 0 || !evp_ctx->keyParam, err);
+    evp_ctx->keyParam = oqsx_keyparam_get(evp_ctx->evp_info);
+    ON_ERR_SET_GOTO(!evp_ctx->keyParam, ret, 0, err);
 
     err:
     return ret;
@@ -502,15 +645,9 @@ static const int oqshybkem_init_ecx(int bit_security, OQSX_EVP_CTX *evp_ctx)
 
     evp_ctx->evp_info = &nids_ecx[idx];
 
-    evp_ctx->keyParam = EVP_PKEY_new();
+    evp_ctx->keyParam = oqsx_keyparam_get(evp_ctx->evp_info);
     ON_ERR_SET_GOTO(!evp_ctx->keyParam, ret, -1, err);
 
-    ret = EVP_PKEY_set_type(evp_ctx->keyParam, evp_ctx->evp_info->keytype);
-    ON_ERR_SET_GOTO(ret <= 0, ret, -1, err);
-
-    evp_ctx->ctx = EVP_PKEY_CTX_new(evp_ctx->keyParam, NULL);
-    ON_ERR_SET_GOTO(!evp_ctx->ctx, ret, -1, err);
-
     err:
     return ret;
 }
@@ -520,14 +657,26 @@ static const int (*init_kex_fun[])(int, OQSX_EVP_CTX *) = {
         oqshybkem_init_ecx
 };
 
+/*
+ * A key is a single allocation holding, at offsets computed from the sizes
+ * of its algorithm, the OQSX_KEY, its comp_privkey and comp_pubkey arrays,
+ * the OQSX_EVP_CTX of hybrids, the public key buffer and the TLS name. Only
+ * the private key gets its own (secure) allocation, made when it is needed
+ * from the thread's arena; see oqsx_key_allocate_keymaterial().
+ */
+#define OQSX_KEY_ALIGN(n) (((n) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
 OQSX_KEY *oqsx_key_new(OSSL_LIB_CTX *libctx, char* oqs_name, char* tls_name, int primitive, const char *propq, int bit_security)
 {
-    OQSX_KEY *ret = OPENSSL_zalloc(sizeof(*ret));
-    OQSX_EVP_CTX *evp_ctx = NULL;
+    OQSX_KEY *ret = NULL;
+    OQSX_QS_CTX qs_ctx;
+    OQSX_EVP_CTX evp_ctx = { NULL, NULL };
+    int is_kem = primitive != KEY_TYPE_SIG && primitive != KEY_TYPE_HYB_SIG;
+    size_t numkeys = 1, privkeylen, pubkeylen, namelen;
+    size_t off_comp, off_evp, off_pub, off_name;
+    unsigned char *slab;
     int ret2 = 0;
 
-    if (ret == NULL) goto err;
-
     if (oqs_name == NULL) {
         OQS_KEY_PRINTF("OQSX_KEY: Fatal error: No OQS key name provided:\n");
         goto err;
@@ -540,100 +689,92 @@ OQSX_KEY *oqsx_key_new(OSSL_LIB_CTX *libctx, char* oqs_name, char* tls_name, int
 
     switch(primitive) {
     case KEY_TYPE_SIG:
-        ret->numkeys = 1;
-        ret->comp_privkey = OPENSSL_malloc(sizeof(void *));
-        ret->comp_pubkey = OPENSSL_malloc(sizeof(void *));
-        ret->oqsx_provider_ctx.oqsx_qs_ctx.sig = OQS_SIG_new(oqs_name);
-        if (!ret->oqsx_provider_ctx.oqsx_qs_ctx.sig) {
-            fprintf(stderr, "Could not create OQS signature algorithm %s. Enabled in liboqs?\n", oqs_name);
-            goto err;
-        }
-        ret->privkeylen = ret->oqsx_provider_ctx.oqsx_qs_ctx.sig->length_secret_key;
-        ret->pubkeylen = ret->oqsx_provider_ctx.oqsx_qs_ctx.sig->length_public_key;
-        ret->keytype = KEY_TYPE_SIG;
-	break;
     case KEY_TYPE_KEM:
-        ret->numkeys = 1;
-        ret->comp_privkey = OPENSSL_malloc(sizeof(void *));
-        ret->comp_pubkey = OPENSSL_malloc(sizeof(void *));
-        ret->oqsx_provider_ctx.oqsx_qs_ctx.kem = OQS_KEM_new(oqs_name);
-        if (!ret->oqsx_provider_ctx.oqsx_qs_ctx.kem) {
-            fprintf(stderr, "Could not create OQS KEM algorithm %s. Enabled in liboqs?\n", oqs_name);
-            goto err;
-        }
-        ret->privkeylen = ret->oqsx_provider_ctx.oqsx_qs_ctx.kem->length_secret_key;
-        ret->pubkeylen = ret->oqsx_provider_ctx.oqsx_qs_ctx.kem->length_public_key;
-        ret->keytype = KEY_TYPE_KEM;
-	break;
+        break;
     case KEY_TYPE_ECX_HYB_KEM:
     case KEY_TYPE_ECP_HYB_KEM:
-        ret->oqsx_provider_ctx.oqsx_qs_ctx.kem = OQS_KEM_new(oqs_name);
-        if (!ret->oqsx_provider_ctx.oqsx_qs_ctx.kem) {
-            fprintf(stderr, "Could not create OQS KEM algorithm %s. Enabled in liboqs?\n", oqs_name);
-            goto err;
-        }
-        evp_ctx = OPENSSL_zalloc(sizeof(OQSX_EVP_CTX));
-        ON_ERR_GOTO(!evp_ctx, err);
-
         ret2 = (init_kex_fun[primitive - KEY_TYPE_ECP_HYB_KEM])
 #ifdef CLOUDFLARE
-                (((!strcmp("Kyber768", oqs_name)&&(primitive==KEY_TYPE_ECX_HYB_KEM)))?128:bit_security, evp_ctx);
+                (((!strcmp("Kyber768", oqs_name)&&(primitive==KEY_TYPE_ECX_HYB_KEM)))?128:bit_security, &evp_ctx);
 #else
-                (bit_security, evp_ctx);
+                (bit_security, &evp_ctx);
 #endif
-        ON_ERR_GOTO(ret2 <= 0 || !evp_ctx->keyParam || !evp_ctx->ctx, err);
-
-        ret->numkeys = 2;
-        ret->comp_privkey = OPENSSL_malloc(ret->numkeys * sizeof(void *));
-        ret->comp_pubkey = OPENSSL_malloc(ret->numkeys * sizeof(void *));
-        ret->privkeylen = (ret->numkeys-1)*SIZE_OF_UINT32 + ret->oqsx_provider_ctx.oqsx_qs_ctx.kem->length_secret_key + evp_ctx->evp_info->length_private_key;
-        ret->pubkeylen = (ret->numkeys-1)*SIZE_OF_UINT32 + ret->oqsx_provider_ctx.oqsx_qs_ctx.kem->length_public_key + evp_ctx->evp_info->length_public_key;
-        ret->oqsx_provider_ctx.oqsx_evp_ctx = evp_ctx;
-        ret->keytype = primitive;
-	break;
+        ON_ERR_GOTO(ret2 <= 0 || !evp_ctx.keyParam, err);
+        numkeys = 2;
+        break;
     case KEY_TYPE_HYB_SIG:
-        ret->oqsx_provider_ctx.oqsx_qs_ctx.sig = OQS_SIG_new(oqs_name);
-        if (!ret->oqsx_provider_ctx.oqsx_qs_ctx.sig) {
+        ret2 = oqsx_hybsig_init(bit_security, &evp_ctx, tls_name);
+        ON_ERR_GOTO(ret2 <= 0, err);
+        numkeys = 2;
+        break;
+    default:
+        OQS_KEY_PRINTF2("OQSX_KEY: Unknown key type encountered: %d\n", primitive);
+        goto err;
+    }
+
+    qs_ctx = oqsx_qs_get(oqs_name, is_kem);
+    if (is_kem) {
+        if (!qs_ctx.kem) {
+            fprintf(stderr, "Could not create OQS KEM algorithm %s. Enabled in liboqs?\n", oqs_name);
+            goto err;
+        }
+        privkeylen = qs_ctx.kem->length_secret_key;
+        pubkeylen = qs_ctx.kem->length_public_key;
+    } else {
+        if (!qs_ctx.sig) {
             fprintf(stderr, "Could not create OQS signature algorithm %s. Enabled in liboqs?\n", oqs_name);
             goto err;
         }
-        evp_ctx = OPENSSL_zalloc(sizeof(OQSX_EVP_CTX));
-        ON_ERR_GOTO(!evp_ctx, err);
-
-	ret2 = oqsx_hybsig_init(bit_security, evp_ctx, tls_name);
-        ON_ERR_GOTO(ret2 <= 0 || !evp_ctx->ctx, err);
-
-        ret->numkeys = 2;
-        ret->comp_privkey = OPENSSL_malloc(ret->numkeys * sizeof(void *));
-        ret->comp_pubkey = OPENSSL_malloc(ret->numkeys * sizeof(void *));
-        ret->privkeylen = (ret->numkeys-1) * SIZE_OF_UINT32 + ret->oqsx_provider_ctx.oqsx_qs_ctx.sig->length_secret_key + evp_ctx->evp_info->length_private_key;
-        ret->pubkeylen = (ret->numkeys-1) * SIZE_OF_UINT32 + ret->oqsx_provider_ctx.oqsx_qs_ctx.sig->length_public_key + evp_ctx->evp_info->length_public_key;
-        ret->oqsx_provider_ctx.oqsx_evp_ctx = evp_ctx;
-        ret->keytype = primitive;
-	ret->evp_info = evp_ctx->evp_info;
-	break;
-    default: 
-        OQS_KEY_PRINTF2("OQSX_KEY: Unknown key type encountered: %d\n", primitive);
-	goto err;
+        privkeylen = qs_ctx.sig->length_secret_key;
+        pubkeylen = qs_ctx.sig->length_public_key;
+    }
+    if (numkeys == 2) {
+        privkeylen += (numkeys-1) * SIZE_OF_UINT32 + evp_ctx.evp_info->length_private_key;
+        pubkeylen += (numkeys-1) * SIZE_OF_UINT32 + evp_ctx.evp_info->length_public_key;
     }
 
+    namelen = strlen(tls_name) + 1;
+    off_comp = OQSX_KEY_ALIGN(sizeof(OQSX_KEY));
+    off_evp = off_comp + 2 * numkeys * sizeof(void *);
+    off_pub = OQSX_KEY_ALIGN(off_evp + (numkeys > 1 ? sizeof(OQSX_EVP_CTX) : 0));
+    off_name = off_pub + pubkeylen;
+    slab = OPENSSL_zalloc(off_name + namelen);
+    ON_ERR_GOTO(!slab, err);
+
+    ret = (OQSX_KEY *)slab;
+    ret->comp_privkey = (void **)(slab + off_comp);
+    ret->comp_pubkey = ret->comp_privkey + numkeys;
+    if (numkeys > 1) {
+        ret->oqsx_provider_ctx.oqsx_evp_ctx = (OQSX_EVP_CTX *)(slab + off_evp);
+        *ret->oqsx_provider_ctx.oqsx_evp_ctx = evp_ctx;
+        if (primitive == KEY_TYPE_HYB_SIG)
+            ret->evp_info = evp_ctx.evp_info;
+    }
+    ret->pubkey_slab = slab + off_pub;
+    ret->tls_name = (char *)(slab + off_name);
+    memcpy(ret->tls_name, tls_name, namelen);
+    ret->stats = oqsx_stats_get(tls_name);
+
+    ret->oqsx_provider_ctx.oqsx_qs_ctx = qs_ctx;
+    ret->keytype = primitive;
+    ret->numkeys = numkeys;
+    ret->privkeylen = privkeylen;
+    ret->pubkeylen = pubkeylen;
     ret->libctx = libctx;
     ret->references = 1;
-    ret->tls_name = OPENSSL_strdup(tls_name);
     ret->bit_security = bit_security;
 
-    if (propq != NULL) {
-        ret->propq = OPENSSL_strdup(propq);
+    if (propq != NULL && (ret->propq = OPENSSL_strdup(propq)) == NULL) {
         ERR_raise(ERR_LIB_USER, ERR_R_MALLOC_FAILURE);
-        if (ret->propq == NULL)
-            goto err;
+        oqsx_key_free(ret);
+        return NULL;
     }
 
     OQS_KEY_PRINTF2("OQSX_KEY: new key created: %p\n", ret);
     return ret;
 err:
     ERR_raise(ERR_LIB_USER, ERR_R_MALLOC_FAILURE);
-    OPENSSL_free(ret);
+    EVP_PKEY_free(evp_ctx.keyParam);
     return NULL;
 }
 
@@ -656,21 +797,11 @@ void oqsx_key_free(OQSX_KEY *key)
 #endif
 
     OPENSSL_free(key->propq);
-    OPENSSL_free(key->tls_name);
-    OPENSSL_secure_clear_free(key->privkey, key->privkeylen);
-    OPENSSL_secure_clear_free(key->pubkey, key->pubkeylen);
-    OPENSSL_free(key->comp_pubkey);
-    OPENSSL_free(key->comp_privkey);
-    if (key->keytype == KEY_TYPE_KEM)
-        OQS_KEM_free(key->oqsx_provider_ctx.oqsx_qs_ctx.kem);
-    else if (key->keytype == KEY_TYPE_ECP_HYB_KEM || key->keytype == KEY_TYPE_ECX_HYB_KEM) {
-        OQS_KEM_free(key->oqsx_provider_ctx.oqsx_qs_ctx.kem);
-        EVP_PKEY_CTX_free(key->oqsx_provider_ctx.oqsx_evp_ctx->ctx);
+    oqsx_privkey_free(key->privkey, key->privkeylen);
+    if (key->oqsx_provider_ctx.oqsx_evp_ctx)
         EVP_PKEY_free(key->oqsx_provider_ctx.oqsx_evp_ctx->keyParam);
-        OPENSSL_free(key->oqsx_provider_ctx.oqsx_evp_ctx);
-    } else
-        OQS_SIG_free(key->oqsx_provider_ctx.oqsx_qs_ctx.sig);
-    OPENSSL_free(key->classical_pkey);
+    EVP_PKEY_free(key->classical_pkey);
+    // everything else lives in the key's own allocation, see oqsx_key_new()
     OPENSSL_free(key);
 }
 
@@ -692,21 +823,125 @@ int oqsx_key_allocate_keymaterial(OQSX_KEY *key, int include_private)
     int ret = 0;
 
     if (!key->privkey && include_private) {
-        key->privkey = OPENSSL_secure_zalloc(key->privkeylen);
+        key->privkey = oqsx_privkey_alloc(key->privkeylen);
         ON_ERR_SET_GOTO(!key->privkey, ret, 1, err);
     }
-    if (!key->pubkey && !include_private) {
-        key->pubkey = OPENSSL_secure_zalloc(key->pubkeylen);
-        ON_ERR_SET_GOTO(!key->pubkey, ret, 1, err);
-    }
+    if (!key->pubkey && !include_private)
+        key->pubkey = key->pubkey_slab;
     err:
     return ret;
 }
 
+/* parses the classical half of a hybrid key, from its private key if set */
+static EVP_PKEY *oqsx_key_decode_classical_pkey(const OQSX_KEY *key)
+{
+    EVP_PKEY *pkey = NULL;
+    int classical_len;
+
+    if (key->privkey != NULL) {
+        const unsigned char *enc_privkey = key->comp_privkey[0];
+
+        DECODE_UINT32(classical_len, key->privkey);
+        pkey = d2i_PrivateKey(key->evp_info->keytype, NULL, &enc_privkey, classical_len);
+    } else if (key->pubkey != NULL) {
+        const unsigned char *enc_pubkey = key->comp_pubkey[0];
+        EVP_PKEY *npk = EVP_PKEY_new();
+
+        if (npk != NULL && key->evp_info->keytype != EVP_PKEY_RSA
+            && setECParams(npk, key->evp_info->nid) == NULL) {
+            EVP_PKEY_free(npk);
+            npk = NULL;
+        }
+        DECODE_UINT32(classical_len, key->pubkey);
+        if (npk != NULL
+            && (pkey = d2i_PublicKey(key->evp_info->keytype, &npk, &enc_pubkey,
+                                     classical_len)) == NULL)
+            EVP_PKEY_free(npk);
+    }
+    if (pkey == NULL)
+        ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_ENCODING);
+    return pkey;
+}
+
+/* hybrid signature keys need their classical half to sign and verify */
+static int oqsx_key_recreate_classical_sig_pkey(OQSX_KEY *key)
+{
+    EVP_PKEY *pkey;
+
+    if (key->evp_info == NULL || key->evp_info->raw_key_support) {
+        ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_ENCODING);
+        return 0;
+    }
+    if (key->privkey == NULL && key->pubkey == NULL)
+        return 1;
+    if ((pkey = oqsx_key_decode_classical_pkey(key)) == NULL)
+        return 0;
+    EVP_PKEY_free(atomic_exchange(&key->classical_pkey, pkey));
+    return 1;
+}
+
+/*
+ * Decoding a hybrid key only copies its encoding, as tools loading keys to
+ * inspect, re-encode or fingerprint them never need an EVP_PKEY of their
+ * classical half. It is parsed here when first needed, and for a private
+ * key, the classical public key is then re-created in the public key
+ * buffer. The lock only serializes that one-time step; afterwards the
+ * acquire load of classical_deferred sees 0 and returns.
+ */
+static pthread_mutex_t oqsx_classical_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int oqsx_key_materialize(const OQSX_KEY *ckey)
+{
+    OQSX_KEY *key = (OQSX_KEY *)ckey;
+    EVP_PKEY *pkey;
+    int ret = 1;
+
+    if (!atomic_load_explicit(&key->classical_deferred, memory_order_acquire))
+        return 1;
+    pthread_mutex_lock(&oqsx_classical_lock);
+    if (atomic_load_explicit(&key->classical_deferred, memory_order_relaxed)) {
+        ret = (pkey = oqsx_key_decode_classical_pkey(key)) != NULL;
+#ifndef NOPUBKEY_IN_PRIVKEY
+        if (ret && key->privkey != NULL && key->pubkey != NULL) {
+            unsigned char *enc_pubkey = key->comp_pubkey[0];
+
+            if (i2d_PublicKey(pkey, &enc_pubkey) != key->evp_info->length_public_key) {
+                ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_ENCODING);
+                EVP_PKEY_free(pkey);
+                ret = 0;
+            }
+        }
+#endif
+        if (ret) {
+            EVP_PKEY_free(atomic_exchange(&key->classical_pkey, pkey));
+            atomic_store_explicit(&key->classical_deferred, 0, memory_order_release);
+        }
+    }
+    pthread_mutex_unlock(&oqsx_classical_lock);
+    return ret;
+}
+
+/*
+ * Only a private key decoded without its classical public key lacks part of
+ * its public key, and deriving that takes the parse anyway. Keys decoded from
+ * a SubjectPublicKeyInfo stay unparsed.
+ */
+int oqsx_key_complete_pubkey(const OQSX_KEY *key)
+{
+#ifndef NOPUBKEY_IN_PRIVKEY
+    if (key->privkey != NULL)
+        return oqsx_key_materialize(key);
+#endif
+    return 1;
+}
+
 int oqsx_key_fromdata(OQSX_KEY *key, const OSSL_PARAM params[], int include_private)
 {
     const OSSL_PARAM *p;
 
+    oqsx_key_reset_classical_pkey(key);
+    atomic_store(&key->classical_deferred, 0);
+
     p = OSSL_PARAM_locate_const(params, OSSL_PKEY_PARAM_PRIV_KEY);
     if (p != NULL) {
         if (p->data_type != OSSL_PARAM_OCTET_STRING) {
@@ -717,9 +952,7 @@ int oqsx_key_fromdata(OQSX_KEY *key, const OSSL_PARAM params[], int include_priv
             ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_SIZE);
             return 0;
         }
-        OPENSSL_secure_clear_free(key->privkey, p->data_size);
-        key->privkey = OPENSSL_secure_malloc(p->data_size);
-        if (key->privkey == NULL) {
+        if (oqsx_key_allocate_keymaterial(key, 1)) {
             ERR_raise(ERR_LIB_USER, ERR_R_MALLOC_FAILURE);
             return 0;
         }
@@ -735,14 +968,13 @@ int oqsx_key_fromdata(OQSX_KEY *key, const OSSL_PARAM params[], int include_priv
             ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_SIZE);
             return 0;
         }
-        OPENSSL_secure_clear_free(key->pubkey, p->data_size);
-        key->pubkey = OPENSSL_secure_malloc(p->data_size);
-        if (key->pubkey == NULL) {
-            ERR_raise(ERR_LIB_USER, ERR_R_MALLOC_FAILURE);
-            return 0;
-        }
+        oqsx_key_allocate_keymaterial(key, 0);
         memcpy(key->pubkey, p->data, p->data_size);
     }
+    if (oqsx_key_set_composites(key))
+        return 0;
+    if (key->keytype == KEY_TYPE_HYB_SIG && !oqsx_key_recreate_classical_sig_pkey(key))
+        return 0;
     return 1;
 }
 
@@ -794,16 +1026,11 @@ static EVP_PKEY* oqsx_key_gen_evp_key(OQSX_EVP_CTX *ctx, unsigned char *pubkey,
     }
     else {
         unsigned char* pubkey_enc = pubkey+SIZE_OF_UINT32;
-        const unsigned char* pubkey_enc2 = pubkey+SIZE_OF_UINT32;
         pubkeylen = i2d_PublicKey(pkey, &pubkey_enc);
         ON_ERR_SET_GOTO(!pubkey_enc || pubkeylen > (int) ctx->evp_info->length_public_key, ret, -11, errhyb);
         unsigned char* privkey_enc = privkey+SIZE_OF_UINT32;
-        const unsigned char* privkey_enc2 = privkey+SIZE_OF_UINT32;
         privkeylen = i2d_PrivateKey(pkey, &privkey_enc);
         ON_ERR_SET_GOTO(!privkey_enc || privkeylen > (int) ctx->evp_info->length_private_key, ret, -12, errhyb);
-        // selftest:
-        EVP_PKEY* ck2 = d2i_PrivateKey(ctx->evp_info->keytype, NULL, &privkey_enc2, privkeylen);
-        ON_ERR_SET_GOTO(!ck2, ret, -14, errhyb);
     }
     ENCODE_UINT32(pubkey,pubkeylen);
     ENCODE_UINT32(privkey,privkeylen);
@@ -820,8 +1047,87 @@ static EVP_PKEY* oqsx_key_gen_evp_key(OQSX_EVP_CTX *ctx, unsigned char *pubkey,
     return NULL;
 }
 
+/* the classical half re-read from the encoding stored in privkey matches pkey */
+static int oqsx_key_check_classical(const OQSX_KEY *key, const EVP_PKEY *pkey)
+{
+    const OQSX_EVP_INFO *evp_info = key->oqsx_provider_ctx.oqsx_evp_ctx->evp_info;
+    const unsigned char *enc_privkey = key->comp_privkey[0];
+    EVP_PKEY *ck2;
+    int classical_len, ret;
+
+    DECODE_UINT32(classical_len, key->privkey);
+    if (evp_info->raw_key_support)
+        ck2 = EVP_PKEY_new_raw_private_key(evp_info->keytype, NULL, enc_privkey, classical_len);
+    else
+        ck2 = d2i_PrivateKey(evp_info->keytype, NULL, &enc_privkey, classical_len);
+    ret = ck2 != NULL && EVP_PKEY_eq(ck2, pkey) == 1;
+    EVP_PKEY_free(ck2);
+    return ret;
+}
+
+/* the private keys of both halves work with their public keys */
+static int oqsx_key_check_pairwise(const OQSX_KEY *key, EVP_PKEY *pkey)
+{
+    const unsigned char *pubkey = key->comp_pubkey[key->numkeys-1];
+    const unsigned char *privkey = key->comp_privkey[key->numkeys-1];
+    static const unsigned char msg[32] = { 0 };
+    unsigned char *buf = NULL, *secret = NULL;
+    EVP_PKEY_CTX *ctx;
+    size_t len, secretlen = 0;
+    int ret = 1;
+
+    if (pkey != NULL) {
+        ctx = EVP_PKEY_CTX_new_from_pkey(key->libctx, pkey, key->propq);
+        ret = ctx != NULL && EVP_PKEY_pairwise_check(ctx) == 1;
+        EVP_PKEY_CTX_free(ctx);
+    }
+    if (ret && key->keytype != KEY_TYPE_SIG && key->keytype != KEY_TYPE_HYB_SIG) {
+        const OQS_KEM *kem = key->oqsx_provider_ctx.oqsx_qs_ctx.kem;
+
+        // the two shared secrets, then the ciphertext
+        secretlen = kem->length_shared_secret;
+        ret = (secret = OPENSSL_malloc(2 * secretlen)) != NULL
+              && (buf = OPENSSL_malloc(kem->length_ciphertext)) != NULL
+              && OQS_KEM_encaps(kem, buf, secret, pubkey) == OQS_SUCCESS
+              && OQS_KEM_decaps(kem, secret + secretlen, buf, privkey) == OQS_SUCCESS
+              && CRYPTO_memcmp(secret, secret + secretlen, secretlen) == 0;
+    } else if (ret) {
+        const OQS_SIG *sig = key->oqsx_provider_ctx.oqsx_qs_ctx.sig;
+
+        len = sig->length_signature;
+        ret = (buf = OPENSSL_malloc(len)) != NULL
+              && OQS_SIG_sign(sig, buf, &len, msg, sizeof(msg), privkey) == OQS_SUCCESS
+              && OQS_SIG_verify(sig, msg, sizeof(msg), buf, len, pubkey) == OQS_SUCCESS;
+    }
+    OPENSSL_clear_free(secret, 2 * secretlen);
+    OPENSSL_free(buf);
+    return ret;
+}
+
+/* checks a freshly generated key as far as validation asks for */
+static int oqsx_key_validate(const OQSX_KEY *key, EVP_PKEY *pkey, OQSX_VALIDATION validation)
+{
+    if (validation >= OQSX_VALIDATE_CLASSICAL && pkey != NULL
+        && !oqsx_key_check_classical(key, pkey))
+        return 0;
+    if (validation >= OQSX_VALIDATE_FULL && !oqsx_key_check_pairwise(key, pkey))
+        return 0;
+    return 1;
+}
+
+int oqsx_validation_from_name(const char *name)
+{
+    if (strcmp(name, "off") == 0)
+        return OQSX_VALIDATE_OFF;
+    if (strcmp(name, "classical") == 0)
+        return OQSX_VALIDATE_CLASSICAL;
+    if (strcmp(name, "full") == 0)
+        return OQSX_VALIDATE_FULL;
+    return -1;
+}
+
 /* allocates OQS and classical keys; retains EVP_PKEY on success for sig OQSX_KEY */
-int oqsx_key_gen(OQSX_KEY *key)
+int oqsx_key_gen(OQSX_KEY *key, OQSX_VALIDATION validation)
 {
     int ret = 0;
     EVP_PKEY* pkey = NULL;
@@ -842,14 +1148,9 @@ int oqsx_key_gen(OQSX_KEY *key)
         ON_ERR_GOTO(ret, err);
         OQS_KEY_PRINTF3("OQSKM: OQSX_KEY privkeylen %ld & pubkeylen: %ld\n", key->privkeylen, key->pubkeylen);
 
-        if (key->keytype == KEY_TYPE_HYB_SIG) {
-           key->classical_pkey = pkey;
-           ret = oqsx_key_gen_oqs(key, 0);
-	}
-	else {
-           EVP_PKEY_free(pkey);
-           ret = oqsx_key_gen_oqs(key, 1);
-	}
+        // retain classical key: hybrid KEMs reuse it for decapsulation
+        key->classical_pkey = pkey;
+        ret = oqsx_key_gen_oqs(key, key->keytype != KEY_TYPE_HYB_SIG);
     } else if (key->keytype == KEY_TYPE_SIG) {
         ret = oqsx_key_set_composites(key);
         ON_ERR_GOTO(ret, err);
@@ -857,6 +1158,11 @@ int oqsx_key_gen(OQSX_KEY *key)
     } else {
         ret = 1;
     }
+    if (ret == 0 && validation != OQSX_VALIDATE_OFF && !oqsx_key_validate(key, pkey, validation)) {
+        OQS_KEY_PRINTF2("OQSKM: validation of generated %s key failed\n", key->tls_name);
+        ERR_raise(ERR_LIB_USER, OQSPROV_R_INVALID_KEY);
+        ret = 1;
+    }
     err:
 	if (ret) {
 		EVP_PKEY_free(pkey);
@@ -865,6 +1171,47 @@ int oqsx_key_gen(OQSX_KEY *key)
     return ret;
 }
 
+EVP_PKEY *oqsx_key_get0_classical_pkey(OQSX_KEY *key)
+{
+    const OQSX_EVP_CTX *evp_ctx = key->oqsx_provider_ctx.oqsx_evp_ctx;
+    const unsigned char *privkey_kex;
+    EVP_PKEY *pkey, *expected = NULL;
+
+    if (!oqsx_key_materialize(key))
+        return NULL;
+    pkey = atomic_load_explicit(&key->classical_pkey, memory_order_acquire);
+    if (pkey != NULL)
+        return pkey;
+    if ((key->keytype != KEY_TYPE_ECP_HYB_KEM && key->keytype != KEY_TYPE_ECX_HYB_KEM)
+        || key->privkey == NULL || key->comp_privkey[0] == NULL)
+        return NULL;
+
+    privkey_kex = key->comp_privkey[0];
+    if (evp_ctx->evp_info->raw_key_support)
+        pkey = EVP_PKEY_new_raw_private_key(evp_ctx->evp_info->keytype, NULL, privkey_kex,
+                                            evp_ctx->evp_info->length_private_key);
+    else
+        pkey = d2i_AutoPrivateKey(NULL, &privkey_kex, evp_ctx->evp_info->length_private_key);
+    if (pkey == NULL)
+        return NULL;
+
+    // concurrent first users may race here: only one key gets installed
+    if (!atomic_compare_exchange_strong_explicit(&key->classical_pkey, &expected, pkey,
+                                                 memory_order_acq_rel, memory_order_acquire)) {
+        EVP_PKEY_free(pkey);
+        pkey = expected;
+    }
+    return pkey;
+}
+
+void oqsx_key_reset_classical_pkey(OQSX_KEY *key)
+{
+    if (key->keytype == KEY_TYPE_ECP_HYB_KEM || key->keytype == KEY_TYPE_ECX_HYB_KEM) {
+        EVP_PKEY_free(atomic_exchange(&key->classical_pkey, NULL));
+        atomic_store(&key->classical_deferred, 0);
+    }
+}
+
 int oqsx_key_secbits(OQSX_KEY *key) {
     return key->bit_security;
 }
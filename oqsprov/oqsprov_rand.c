@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * OQS OpenSSL 3 provider
+ *
+ * Randomness for liboqs. liboqs draws the randomness of key generation,
+ * encapsulation and signing through OQS_randombytes(), from its default
+ * backend unless told otherwise. While a provider is loaded, its library
+ * context's private DRBG serves it instead: that DRBG exists per thread,
+ * is fetched with the library context's properties (e.g. "fips=yes"), and
+ * the small requests of liboqs are served from a per-thread buffer filled
+ * by one RAND_priv_bytes_ex() call.
+ *
+ * liboqs has a single, process-wide backend that takes no context: it is
+ * bound to the first provider context loaded and liboqs' default is
+ * restored when that is freed. A buffer is dropped once it belongs to an
+ * earlier binding or to the parent of a forked process, and served bytes
+ * are cleansed right away.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include <openssl/rand.h>
+#include "oqs_prov.h"
+
+#define OQS_RAND_PRINTF2(a, b) OQSX_TRACE(OQSX_TRACE_PROV, a, b)
+
+#define OQSX_RAND_BUFSIZE 256
+/* RAND_priv_bytes_ex() takes an int */
+#define OQSX_RAND_MAXREQ (1 << 20)
+
+typedef struct {
+    unsigned int generation;
+    size_t avail;  /* unused bytes at the end of buf */
+    unsigned char buf[OQSX_RAND_BUFSIZE];
+} OQSX_RAND_BUFFER;
+
+static pthread_rwlock_t oqsx_rand_lock = PTHREAD_RWLOCK_INITIALIZER;
+static OSSL_LIB_CTX *oqsx_rand_libctx = NULL;  /* under the lock */
+/* bumped on every (un)binding and in forked children */
+static _Atomic unsigned int oqsx_rand_generation = 1;
+static pthread_once_t oqsx_rand_atfork_once = PTHREAD_ONCE_INIT;
+
+static _Thread_local OQSX_RAND_BUFFER oqsx_rand_buffer;
+
+static void oqsx_rand_atfork_child(void)
+{
+    atomic_fetch_add(&oqsx_rand_generation, 1);
+}
+
+static void oqsx_rand_register_atfork(void)
+{
+    pthread_atfork(NULL, NULL, oqsx_rand_atfork_child);
+}
+
+/* len <= OQSX_RAND_MAXREQ bytes from the bound DRBG */
+static void oqsx_rand_fill(unsigned char *out, size_t len)
+{
+    int ok;
+
+    pthread_rwlock_rdlock(&oqsx_rand_lock);
+    // only a caller racing with unbinding can see NULL: use the default context
+    ok = RAND_priv_bytes_ex(oqsx_rand_libctx, out, len, 0) > 0;
+    pthread_rwlock_unlock(&oqsx_rand_lock);
+    if (!ok)
+        // liboqs can't be told; carrying on with predictable keys is worse
+        OPENSSL_die("oqsprovider: no randomness for liboqs", __FILE__, __LINE__);
+}
+
+static void oqsx_randombytes(uint8_t *out, size_t len)
+{
+    OQSX_RAND_BUFFER *rb = &oqsx_rand_buffer;
+    unsigned int generation = atomic_load_explicit(&oqsx_rand_generation,
+                                                   memory_order_relaxed);
+    unsigned char *p;
+
+    if (rb->generation != generation) {
+        OPENSSL_cleanse(rb->buf, sizeof(rb->buf));
+        rb->avail = 0;
+        rb->generation = generation;
+    }
+    if (len > rb->avail && len < OQSX_RAND_BUFSIZE / 2) {
+        // whatever is left goes unused
+        oqsx_rand_fill(rb->buf, OQSX_RAND_BUFSIZE);
+        rb->avail = OQSX_RAND_BUFSIZE;
+    }
+    if (len <= rb->avail) {
+        p = rb->buf + OQSX_RAND_BUFSIZE - rb->avail;
+        memcpy(out, p, len);
+        OPENSSL_cleanse(p, len);
+        rb->avail -= len;
+        return;
+    }
+    // large requests bypass the buffer
+    for (; len > OQSX_RAND_MAXREQ; out += OQSX_RAND_MAXREQ, len -= OQSX_RAND_MAXREQ)
+        oqsx_rand_fill(out, OQSX_RAND_MAXREQ);
+    oqsx_rand_fill(out, len);
+}
+
+void oqsx_rand_bind(OSSL_LIB_CTX *libctx)
+{
+    pthread_once(&oqsx_rand_atfork_once, oqsx_rand_register_atfork);
+    pthread_rwlock_wrlock(&oqsx_rand_lock);
+    if (oqsx_rand_libctx == NULL) {
+        oqsx_rand_libctx = libctx;
+        atomic_fetch_add(&oqsx_rand_generation, 1);
+        OQS_randombytes_custom_algorithm(oqsx_randombytes);
+        OQS_RAND_PRINTF2("OQS PROV: liboqs randomness from library context %p\n",
+                         (void *)libctx);
+    }
+    pthread_rwlock_unlock(&oqsx_rand_lock);
+}
+
+void oqsx_rand_unbind(OSSL_LIB_CTX *libctx)
+{
+    pthread_rwlock_wrlock(&oqsx_rand_lock);
+    if (oqsx_rand_libctx == libctx && libctx != NULL) {
+        if (OQS_randombytes_switch_algorithm(OQS_RAND_alg_openssl) != OQS_SUCCESS)
+            OQS_randombytes_switch_algorithm(OQS_RAND_alg_system);
+        oqsx_rand_libctx = NULL;
+        atomic_fetch_add(&oqsx_rand_generation, 1);
+    }
+    pthread_rwlock_unlock(&oqsx_rand_lock);
+}
@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * OQS OpenSSL 3 provider
+ *
+ * Always-on per-algorithm operation statistics: for each algorithm and
+ * operation (see OQSX_OP), the number of calls, of failed calls, their
+ * total latency and a histogram of latencies in power-of-2 microsecond
+ * buckets. They are reported by the "op-stats" provider parameter.
+ *
+ * Every algorithm's counters are split into shards, one of which each
+ * thread picks on its first operation, so that threads running the same
+ * algorithm concurrently mostly update different cache lines. Counters are
+ * relaxed atomics; a report sums the shards without stopping updates.
+ *
+ * Like the liboqs descriptor registry, algorithms are added lock-free to an
+ * open-addressing hash table on first use and released with the last
+ * provider context; keys keep a pointer to their algorithm's entry.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/crypto.h>
+#include "oqs_prov.h"
+
+#define STATS_REGISTRY_LEN 256 /* power of 2, well above the number of algorithms */
+#define OQSX_STATS_SHARDS 8
+/* bucket 0: below 1us, bucket i: [2^(i-1), 2^i) us, last: all longer */
+#define OQSX_STATS_BUCKETS 24
+
+typedef struct {
+    _Atomic uint64_t count, errors, total_ns;
+    _Atomic uint64_t buckets[OQSX_STATS_BUCKETS];
+} OQSX_OP_STATS;
+
+struct oqsx_alg_stats_st {
+    OQSX_OP_STATS shards[OQSX_STATS_SHARDS][OQSX_OP_NUM];
+    char name[];
+};
+
+static const char *oqsx_op_names[OQSX_OP_NUM] = {
+    "keygen", "sign", "verify", "encaps", "decaps", "encode", "decode"
+};
+
+static OQSX_ALG_STATS *_Atomic oqsx_stats_registry[STATS_REGISTRY_LEN];
+static _Atomic unsigned int oqsx_stats_next_shard;
+static _Thread_local int oqsx_stats_shard = -1;
+
+static size_t oqsx_stats_hash(const char *name)
+{
+    size_t h = 2166136261u; /* FNV-1a */
+
+    while (*name != '\0')
+        h = (h ^ (unsigned char)*name++) * 16777619u;
+    return h;
+}
+
+OQSX_ALG_STATS *oqsx_stats_get(const char *tls_name)
+{
+    OQSX_ALG_STATS *entry, *fresh = NULL;
+    size_t i, n, namelen;
+
+    if (tls_name == NULL)
+        return NULL;
+    i = oqsx_stats_hash(tls_name);
+    for (n = 0; n < STATS_REGISTRY_LEN; n++, i++) {
+        _Atomic(OQSX_ALG_STATS *) *slot = &oqsx_stats_registry[i & (STATS_REGISTRY_LEN - 1)];
+
+        entry = atomic_load_explicit(slot, memory_order_acquire);
+        if (entry == NULL) {
+            if (fresh == NULL) {
+                namelen = strlen(tls_name) + 1;
+                if ((fresh = OPENSSL_zalloc(sizeof(*fresh) + namelen)) == NULL)
+                    return NULL;
+                memcpy(fresh->name, tls_name, namelen);
+            }
+            if (atomic_compare_exchange_strong_explicit(slot, &entry, fresh,
+                                                        memory_order_acq_rel,
+                                                        memory_order_acquire))
+                return fresh;
+            // another thread took the slot: it may have added the same entry
+        }
+        if (strcmp(entry->name, tls_name) == 0) {
+            OPENSSL_free(fresh);
+            return entry;
+        }
+    }
+    OPENSSL_free(fresh);
+    return NULL;
+}
+
+void oqsx_stats_registry_free(void)
+{
+    int i;
+
+    for (i = 0; i < STATS_REGISTRY_LEN; i++)
+        OPENSSL_free(atomic_exchange(&oqsx_stats_registry[i], NULL));
+}
+
+uint64_t oqsx_stats_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void oqsx_stats_record(OQSX_ALG_STATS *stats, OQSX_OP op, uint64_t start, int ok)
+{
+    uint64_t ns = oqsx_stats_now() - start, us = ns / 1000;
+    OQSX_OP_STATS *ops;
+    int bucket;
+
+    if (stats == NULL)
+        return;
+    if (oqsx_stats_shard < 0)
+        oqsx_stats_shard = atomic_fetch_add(&oqsx_stats_next_shard, 1) % OQSX_STATS_SHARDS;
+    ops = &stats->shards[oqsx_stats_shard][op];
+
+    for (bucket = 0; us != 0 && bucket < OQSX_STATS_BUCKETS - 1; bucket++)
+        us >>= 1;
+    atomic_fetch_add_explicit(&ops->count, 1, memory_order_relaxed);
+    if (!ok)
+        atomic_fetch_add_explicit(&ops->errors, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&ops->total_ns, ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&ops->buckets[bucket], 1, memory_order_relaxed);
+}
+
+/* sums the shards of one algorithm and operation */
+static void oqsx_stats_sum(OQSX_ALG_STATS *stats, OQSX_OP op, uint64_t *count,
+                           uint64_t *errors, uint64_t *total_ns, uint64_t *buckets)
+{
+    int i, b;
+
+    *count = *errors = *total_ns = 0;
+    for (b = 0; b < OQSX_STATS_BUCKETS; b++)
+        buckets[b] = 0;
+    for (i = 0; i < OQSX_STATS_SHARDS; i++) {
+        OQSX_OP_STATS *ops = &stats->shards[i][op];
+
+        *count += atomic_load_explicit(&ops->count, memory_order_relaxed);
+        *errors += atomic_load_explicit(&ops->errors, memory_order_relaxed);
+        *total_ns += atomic_load_explicit(&ops->total_ns, memory_order_relaxed);
+        for (b = 0; b < OQSX_STATS_BUCKETS; b++)
+            buckets[b] += atomic_load_explicit(&ops->buckets[b], memory_order_relaxed);
+    }
+}
+
+size_t oqsx_stats_total(OQSX_OP op)
+{
+    uint64_t count, errors, total_ns, buckets[OQSX_STATS_BUCKETS];
+    size_t total = 0;
+    int i;
+
+    for (i = 0; i < STATS_REGISTRY_LEN; i++) {
+        OQSX_ALG_STATS *stats = atomic_load_explicit(&oqsx_stats_registry[i],
+                                                     memory_order_acquire);
+
+        if (stats != NULL) {
+            oqsx_stats_sum(stats, op, &count, &errors, &total_ns, buckets);
+            total += count;
+        }
+    }
+    return total;
+}
+
+/*
+ * One line per algorithm and operation used so far:
+ * "<algorithm> <operation> <count> <errors> <total us> <bucket 0>,...,<bucket n>"
+ */
+size_t oqsx_stats_report(char *buf, size_t size)
+{
+    uint64_t count, errors, total_ns, buckets[OQSX_STATS_BUCKETS];
+    size_t len = 0;
+    int i, op, b, n;
+
+    if (buf != NULL && size > 0)
+        buf[0] = '\0';
+    for (i = 0; i < STATS_REGISTRY_LEN; i++) {
+        OQSX_ALG_STATS *stats = atomic_load_explicit(&oqsx_stats_registry[i],
+                                                     memory_order_acquire);
+
+        for (op = 0; stats != NULL && op < OQSX_OP_NUM; op++) {
+            oqsx_stats_sum(stats, op, &count, &errors, &total_ns, buckets);
+            if (count == 0)
+                continue;
+            n = snprintf(buf != NULL && len < size ? buf + len : NULL,
+                         buf != NULL && len < size ? size - len : 0,
+                         "%s %s %llu %llu %llu ", stats->name, oqsx_op_names[op],
+                         (unsigned long long)count, (unsigned long long)errors,
+                         (unsigned long long)(total_ns / 1000));
+            len += n > 0 ? n : 0;
+            for (b = 0; b < OQSX_STATS_BUCKETS; b++) {
+                n = snprintf(buf != NULL && len < size ? buf + len : NULL,
+                             buf != NULL && len < size ? size - len : 0,
+                             b < OQSX_STATS_BUCKETS - 1 ? "%llu," : "%llu\n",
+                             (unsigned long long)buckets[b]);
+                len += n > 0 ? n : 0;
+            }
+        }
+    }
+    return len;
+}
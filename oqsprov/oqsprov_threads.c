@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * OQS OpenSSL 3 provider
+ *
+ * Small worker pool used to run independent halves of hybrid operations
+ * concurrently. Jobs are owned by the submitter (typically on its stack);
+ * oqsx_thread_pool_wait() must be called for every successfully submitted
+ * job before its memory goes away.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <openssl/crypto.h>
+#include "oqs_prov.h"
+
+#define OQS_THR_PRINTF(a) OQSX_TRACE(OQSX_TRACE_PROV, a)
+#define OQS_THR_PRINTF2(a, b) OQSX_TRACE(OQSX_TRACE_PROV, a, b)
+
+#define OQSX_THREAD_POOL_MAX 64
+
+enum {
+    OQSX_JOB_QUEUED, OQSX_JOB_RUNNING, OQSX_JOB_DONE
+};
+
+struct oqsx_thread_pool_st {
+    pthread_mutex_t lock;
+    pthread_cond_t work;    /* signalled when a job is queued or on shutdown */
+    pthread_cond_t done;    /* signalled when a job completes */
+    OQSX_JOB *head, *tail;
+    int shutdown;
+    int nthreads;
+    pthread_t threads[];
+};
+
+static void *oqsx_thread_pool_worker(void *arg)
+{
+    OQSX_THREAD_POOL *pool = arg;
+    OQSX_JOB *job;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->head == NULL && !pool->shutdown)
+            pthread_cond_wait(&pool->work, &pool->lock);
+        if (pool->head == NULL)
+            break;
+        job = pool->head;
+        pool->head = job->next;
+        if (pool->head == NULL)
+            pool->tail = NULL;
+        job->state = OQSX_JOB_RUNNING;
+        pthread_mutex_unlock(&pool->lock);
+
+        job->ret = job->fn(job->arg);
+
+        pthread_mutex_lock(&pool->lock);
+        job->state = OQSX_JOB_DONE;
+        pthread_cond_broadcast(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+OQSX_THREAD_POOL *oqsx_thread_pool_new(int nthreads)
+{
+    OQSX_THREAD_POOL *pool;
+
+    if (nthreads <= 0)
+        return NULL;
+    if (nthreads > OQSX_THREAD_POOL_MAX)
+        nthreads = OQSX_THREAD_POOL_MAX;
+
+    pool = OPENSSL_zalloc(sizeof(*pool) + nthreads * sizeof(pthread_t));
+    if (pool == NULL)
+        return NULL;
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        OPENSSL_free(pool);
+        return NULL;
+    }
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (pool->nthreads = 0; pool->nthreads < nthreads; pool->nthreads++) {
+        if (pthread_create(&pool->threads[pool->nthreads], NULL,
+                           oqsx_thread_pool_worker, pool) != 0)
+            break;
+    }
+    if (pool->nthreads == 0) {
+        oqsx_thread_pool_free(pool);
+        return NULL;
+    }
+    OQS_THR_PRINTF2("OQS PROV: started %d worker threads\n", pool->nthreads);
+    return pool;
+}
+
+void oqsx_thread_pool_free(OQSX_THREAD_POOL *pool)
+{
+    int i;
+
+    if (pool == NULL)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for (i = 0; i < pool->nthreads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->done);
+    pthread_mutex_destroy(&pool->lock);
+    OPENSSL_free(pool);
+}
+
+int oqsx_thread_pool_submit(OQSX_THREAD_POOL *pool, OQSX_JOB *job,
+                            int (*fn)(void *), void *arg)
+{
+    if (pool == NULL)
+        return 0;
+
+    job->fn = fn;
+    job->arg = arg;
+    job->ret = 0;
+    job->next = NULL;
+    job->state = OQSX_JOB_QUEUED;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->shutdown) {
+        pthread_mutex_unlock(&pool->lock);
+        return 0;
+    }
+    if (pool->tail != NULL)
+        pool->tail->next = job;
+    else
+        pool->head = job;
+    pool->tail = job;
+    pthread_cond_signal(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    return 1;
+}
+
+/*
+ * A job no worker has picked up yet is taken back off the queue and run by
+ * the caller, so waiting never takes longer than running the job inline.
+ */
+int oqsx_thread_pool_wait(OQSX_THREAD_POOL *pool, OQSX_JOB *job)
+{
+    OQSX_JOB **pp;
+
+    pthread_mutex_lock(&pool->lock);
+    if (job->state == OQSX_JOB_QUEUED) {
+        OQSX_JOB *prev = NULL;
+
+        for (pp = &pool->head; *pp != job; pp = &(*pp)->next)
+            prev = *pp;
+        *pp = job->next;
+        if (pool->tail == job)
+            pool->tail = prev;
+        pthread_mutex_unlock(&pool->lock);
+
+        job->ret = job->fn(job->arg);
+        job->state = OQSX_JOB_DONE;
+        return job->ret;
+    }
+    while (job->state != OQSX_JOB_DONE)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+    return job->ret;
+}
+
+OQSX_THREAD_POOL *oqsx_provctx_get0_pool(PROV_OQS_CTX *provctx)
+{
+    OQSX_THREAD_POOL *pool = atomic_load(&provctx->pool), *expected = NULL;
+
+    if (pool != NULL || provctx->worker_threads <= 0)
+        return pool;
+
+    pool = oqsx_thread_pool_new(provctx->worker_threads);
+    if (pool == NULL)
+        return NULL;
+    if (!atomic_compare_exchange_strong(&provctx->pool, &expected, pool)) {
+        /* lost the race against another thread: use its pool */
+        oqsx_thread_pool_free(pool);
+        pool = expected;
+    }
+    return pool;
+}
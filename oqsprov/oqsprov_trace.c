@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * OQS OpenSSL 3 provider
+ *
+ * Debug tracing. The trace categories (OQSX_TRACE_*) are looked up once,
+ * when the provider is initialized, rather than by every trace statement:
+ * a category is enabled by its environment variable (e.g. OQSSIG) or, if
+ * libcrypto was built with enable-trace, by an OSSL_trace channel set for
+ * the matching OpenSSL category at that time. Trace output goes to that
+ * channel if there is one and to stdout otherwise.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <openssl/bio.h>
+#include <openssl/trace.h>
+#include "oqs_prov.h"
+
+_Atomic unsigned int oqsx_trace_flags;
+
+static const struct {
+    unsigned int category;
+    const char *envvar;
+    int ossl_category;
+} oqsx_trace_categories[] = {
+    { OQSX_TRACE_SIG, "OQSSIG", OSSL_TRACE_CATEGORY_ALL },
+    { OQSX_TRACE_KEM, "OQSKEM", OSSL_TRACE_CATEGORY_ALL },
+    { OQSX_TRACE_KM, "OQSKM", OSSL_TRACE_CATEGORY_ALL },
+    { OQSX_TRACE_KEY, "OQSKEY", OSSL_TRACE_CATEGORY_ALL },
+    { OQSX_TRACE_ENC, "OQSENC", OSSL_TRACE_CATEGORY_ENCODER },
+    { OQSX_TRACE_DEC, "OQSDEC", OSSL_TRACE_CATEGORY_DECODER },
+    { OQSX_TRACE_PROV, "OQSPROV", OSSL_TRACE_CATEGORY_INIT },
+};
+
+void oqsx_trace_init(void)
+{
+    unsigned int flags = 0;
+    size_t i;
+
+    for (i = 0; i < OSSL_NELEM(oqsx_trace_categories); i++)
+        if (getenv(oqsx_trace_categories[i].envvar) != NULL
+            || OSSL_trace_enabled(oqsx_trace_categories[i].ossl_category))
+            flags |= oqsx_trace_categories[i].category;
+    atomic_store(&oqsx_trace_flags, flags);
+}
+
+void oqsx_trace_printf(unsigned int category, const char *fmt, ...)
+{
+    va_list ap;
+#ifndef OPENSSL_NO_TRACE
+    size_t i;
+
+    for (i = 0; i < OSSL_NELEM(oqsx_trace_categories); i++) {
+        int ossl_category = oqsx_trace_categories[i].ossl_category;
+        BIO *out;
+
+        if (oqsx_trace_categories[i].category != category)
+            continue;
+        if (OSSL_trace_enabled(ossl_category)
+            && (out = OSSL_trace_begin(ossl_category)) != NULL) {
+            va_start(ap, fmt);
+            BIO_vprintf(out, fmt, ap);
+            va_end(ap);
+            OSSL_trace_end(ossl_category, out);
+            return;
+        }
+        break;
+    }
+#endif
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * OQS OpenSSL 3 provider
+ *
+ * Cache of successful signature verifications, enabled by the
+ * "verify-cache-size" config key. Certificates of intermediate CAs are
+ * typically verified over and over again, each time with the same public
+ * key, to-be-signed data and (large) signature.
+ *
+ * An entry holds the SHA-256 hash of the algorithm name, the complete
+ * public key, the data and the signature only, each length-prefixed. It is
+ * added once verification of exactly these succeeded; failed verifications
+ * are never cached, so a hit is only possible for inputs that verified
+ * before. Entries expire after "verify-cache-ttl" seconds.
+ *
+ * The cache is split into shards, selected by the hash, each with its own
+ * lock, hash table and LRU list, so that concurrent verifications rarely
+ * contend. Like the key pool, the cache is not used in a child process, as
+ * a shard may have been locked at the time of the fork().
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+#include "oqs_prov.h"
+
+#define OQS_VC_PRINTF3(a, b, c) OQSX_TRACE(OQSX_TRACE_PROV, a, b, c)
+
+#define OQSX_VERIFY_CACHE_SHARDS 16
+
+typedef struct oqsx_verify_cache_entry_st {
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    uint64_t expires;        /* CLOCK_MONOTONIC ns; 0 if not in a bucket */
+    struct oqsx_verify_cache_entry_st *chain;       /* in hash bucket */
+    struct oqsx_verify_cache_entry_st *prev, *next; /* LRU, most recent first */
+} OQSX_VERIFY_CACHE_ENTRY;
+
+typedef struct {
+    pthread_mutex_t lock;
+    size_t count, capacity;
+    size_t nbuckets;                /* power of 2 */
+    OQSX_VERIFY_CACHE_ENTRY **buckets;
+    OQSX_VERIFY_CACHE_ENTRY *entries; /* capacity entries, count in use */
+    OQSX_VERIFY_CACHE_ENTRY *head, *tail;
+    _Atomic size_t hits, misses;
+} OQSX_VERIFY_CACHE_SHARD;
+
+struct oqsx_verify_cache_st {
+    pid_t pid;            /* process owning the cache */
+    uint64_t ttl_ns;
+    OQSX_VERIFY_CACHE_SHARD shards[OQSX_VERIFY_CACHE_SHARDS];
+};
+
+static uint64_t oqsx_verify_cache_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+OQSX_VERIFY_CACHE *oqsx_verify_cache_new(size_t size, size_t ttl)
+{
+    OQSX_VERIFY_CACHE *cache;
+    size_t i, capacity;
+
+    if (size == 0 || ttl == 0)
+        return NULL;
+    capacity = (size + OQSX_VERIFY_CACHE_SHARDS - 1) / OQSX_VERIFY_CACHE_SHARDS;
+
+    if ((cache = OPENSSL_zalloc(sizeof(*cache))) == NULL)
+        return NULL;
+    cache->pid = getpid();
+    cache->ttl_ns = (uint64_t)ttl * 1000000000;
+    for (i = 0; i < OQSX_VERIFY_CACHE_SHARDS; i++) {
+        OQSX_VERIFY_CACHE_SHARD *shard = &cache->shards[i];
+
+        shard->capacity = capacity;
+        for (shard->nbuckets = 1; shard->nbuckets < capacity; shard->nbuckets <<= 1)
+            ;
+        shard->buckets = OPENSSL_zalloc(shard->nbuckets * sizeof(*shard->buckets));
+        shard->entries = OPENSSL_zalloc(capacity * sizeof(*shard->entries));
+        if (shard->buckets == NULL || shard->entries == NULL
+            || pthread_mutex_init(&shard->lock, NULL) != 0) {
+            OPENSSL_free(shard->buckets);
+            OPENSSL_free(shard->entries);
+            shard->buckets = NULL;
+            shard->entries = NULL;
+            oqsx_verify_cache_free(cache);
+            return NULL;
+        }
+    }
+    OQS_VC_PRINTF3("OQS PROV: verify cache of %zu entries, TTL %zu s\n",
+                   capacity * OQSX_VERIFY_CACHE_SHARDS, ttl);
+    return cache;
+}
+
+void oqsx_verify_cache_free(OQSX_VERIFY_CACHE *cache)
+{
+    size_t i;
+
+    if (cache == NULL)
+        return;
+    for (i = 0; i < OQSX_VERIFY_CACHE_SHARDS; i++) {
+        OQSX_VERIFY_CACHE_SHARD *shard = &cache->shards[i];
+
+        if (shard->entries == NULL)
+            break;          /* initialization stopped here */
+        pthread_mutex_destroy(&shard->lock);
+        OPENSSL_free(shard->buckets);
+        OPENSSL_free(shard->entries);
+    }
+    OPENSSL_free(cache);
+}
+
+static int oqsx_verify_cache_hash_update(EVP_MD_CTX *mdctx,
+                                         const unsigned char *data, size_t len)
+{
+    unsigned char prefix[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+        prefix[i] = (unsigned char)((uint64_t)len >> (56 - 8 * i));
+    return EVP_DigestUpdate(mdctx, prefix, sizeof(prefix))
+           && EVP_DigestUpdate(mdctx, data, len);
+}
+
+int oqsx_verify_cache_hash(const OQSX_KEY *key, const unsigned char *tbs,
+                           size_t tbslen, const unsigned char *sig,
+                           size_t siglen, unsigned char *hash)
+{
+    EVP_MD_CTX *mdctx;
+    int ret;
+
+    if (key->tls_name == NULL || key->pubkey == NULL)
+        return 0;
+    ret = (mdctx = EVP_MD_CTX_new()) != NULL
+          && EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL)
+          && oqsx_verify_cache_hash_update(mdctx, (const unsigned char *)key->tls_name,
+                                           strlen(key->tls_name))
+          && oqsx_verify_cache_hash_update(mdctx, key->pubkey, key->pubkeylen)
+          && oqsx_verify_cache_hash_update(mdctx, tbs, tbslen)
+          && oqsx_verify_cache_hash_update(mdctx, sig, siglen)
+          && EVP_DigestFinal_ex(mdctx, hash, NULL);
+    EVP_MD_CTX_free(mdctx);
+    return ret;
+}
+
+static OQSX_VERIFY_CACHE_SHARD *oqsx_verify_cache_shard(OQSX_VERIFY_CACHE *cache,
+                                                        const unsigned char *hash)
+{
+    return &cache->shards[hash[0] % OQSX_VERIFY_CACHE_SHARDS];
+}
+
+static OQSX_VERIFY_CACHE_ENTRY **oqsx_verify_cache_bucket(OQSX_VERIFY_CACHE_SHARD *shard,
+                                                          const unsigned char *hash)
+{
+    size_t h = (size_t)hash[1] | (size_t)hash[2] << 8 | (size_t)hash[3] << 16
+               | (size_t)hash[4] << 24;
+
+    return &shard->buckets[h & (shard->nbuckets - 1)];
+}
+
+static void oqsx_verify_cache_lru_unlink(OQSX_VERIFY_CACHE_SHARD *shard,
+                                         OQSX_VERIFY_CACHE_ENTRY *entry)
+{
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        shard->head = entry->next;
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+    else
+        shard->tail = entry->prev;
+}
+
+static void oqsx_verify_cache_lru_push(OQSX_VERIFY_CACHE_SHARD *shard,
+                                       OQSX_VERIFY_CACHE_ENTRY *entry)
+{
+    entry->prev = NULL;
+    entry->next = shard->head;
+    if (shard->head != NULL)
+        shard->head->prev = entry;
+    else
+        shard->tail = entry;
+    shard->head = entry;
+}
+
+/* takes the entry out of its bucket and the LRU list */
+static void oqsx_verify_cache_unlink(OQSX_VERIFY_CACHE_SHARD *shard,
+                                     OQSX_VERIFY_CACHE_ENTRY *entry)
+{
+    OQSX_VERIFY_CACHE_ENTRY **pp;
+
+    for (pp = oqsx_verify_cache_bucket(shard, entry->hash); *pp != entry;
+         pp = &(*pp)->chain)
+        ;
+    *pp = entry->chain;
+    oqsx_verify_cache_lru_unlink(shard, entry);
+}
+
+int oqsx_verify_cache_lookup(OQSX_VERIFY_CACHE *cache, const unsigned char *hash)
+{
+    OQSX_VERIFY_CACHE_SHARD *shard;
+    OQSX_VERIFY_CACHE_ENTRY *entry;
+    int hit = 0;
+
+    if (cache == NULL || cache->pid != getpid())
+        return 0;
+    shard = oqsx_verify_cache_shard(cache, hash);
+
+    pthread_mutex_lock(&shard->lock);
+    for (entry = *oqsx_verify_cache_bucket(shard, hash); entry != NULL;
+         entry = entry->chain)
+        if (memcmp(entry->hash, hash, SHA256_DIGEST_LENGTH) == 0)
+            break;
+    if (entry != NULL && entry->expires <= oqsx_verify_cache_now()) {
+        /* expired: move it to the end, where it is reused first */
+        oqsx_verify_cache_unlink(shard, entry);
+        entry->chain = NULL;
+        entry->prev = shard->tail;
+        entry->next = NULL;
+        if (shard->tail != NULL)
+            shard->tail->next = entry;
+        else
+            shard->head = entry;
+        shard->tail = entry;
+        memset(entry->hash, 0, SHA256_DIGEST_LENGTH);
+        entry->expires = 0;
+        entry = NULL;
+    }
+    if (entry != NULL) {
+        oqsx_verify_cache_lru_unlink(shard, entry);
+        oqsx_verify_cache_lru_push(shard, entry);
+        hit = 1;
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    atomic_fetch_add(hit ? &shard->hits : &shard->misses, 1);
+    return hit;
+}
+
+void oqsx_verify_cache_add(OQSX_VERIFY_CACHE *cache, const unsigned char *hash)
+{
+    OQSX_VERIFY_CACHE_SHARD *shard;
+    OQSX_VERIFY_CACHE_ENTRY *entry, **bucket;
+
+    if (cache == NULL || cache->pid != getpid())
+        return;
+    shard = oqsx_verify_cache_shard(cache, hash);
+    bucket = oqsx_verify_cache_bucket(shard, hash);
+
+    pthread_mutex_lock(&shard->lock);
+    for (entry = *bucket; entry != NULL; entry = entry->chain)
+        if (memcmp(entry->hash, hash, SHA256_DIGEST_LENGTH) == 0)
+            break;
+    if (entry != NULL) {
+        /* added concurrently by another thread */
+        oqsx_verify_cache_lru_unlink(shard, entry);
+    } else if (shard->count < shard->capacity) {
+        entry = &shard->entries[shard->count++];
+        entry->chain = *bucket;
+        *bucket = entry;
+    } else {
+        /* evict the least recently used (or an expired) entry */
+        entry = shard->tail;
+        if (entry->expires != 0)
+            oqsx_verify_cache_unlink(shard, entry);
+        else
+            oqsx_verify_cache_lru_unlink(shard, entry);
+        entry->chain = *bucket;
+        *bucket = entry;
+    }
+    memcpy(entry->hash, hash, SHA256_DIGEST_LENGTH);
+    entry->expires = oqsx_verify_cache_now() + cache->ttl_ns;
+    oqsx_verify_cache_lru_push(shard, entry);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+void oqsx_verify_cache_stats(OQSX_VERIFY_CACHE *cache, size_t *hits,
+                             size_t *misses)
+{
+    size_t i;
+
+    *hits = *misses = 0;
+    if (cache == NULL)
+        return;
+    for (i = 0; i < OQSX_VERIFY_CACHE_SHARDS; i++) {
+        *hits += atomic_load(&cache->shards[i].hits);
+        *misses += atomic_load(&cache->shards[i].misses);
+    }
+}
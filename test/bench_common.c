@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/core.h>
+#include <openssl/crypto.h>
+#include "bench_common.h"
+#include "test_common.h"
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+int bench_run(bench_fn fn, void *arg, double min_seconds, bench_result *res)
+{
+    uint64_t *lat = NULL, start, t0, t1, budget;
+    size_t n = 0, alloc = 0;
+    int ok = 1;
+
+    memset(res, 0, sizeof(*res));
+    budget = (uint64_t)(min_seconds * 1e9);
+    start = bench_now_ns();
+    do {
+        if (n == alloc) {
+            uint64_t *newlat;
+
+            alloc = alloc ? 2 * alloc : 1024;
+            newlat = OPENSSL_realloc(lat, alloc * sizeof(*lat));
+            if (newlat == NULL) {
+                ok = 0;
+                break;
+            }
+            lat = newlat;
+        }
+        t0 = bench_now_ns();
+        if (!fn(arg)) {
+            ok = 0;
+            break;
+        }
+        t1 = bench_now_ns();
+        lat[n++] = t1 - t0;
+    } while (t1 - start < budget);
+
+    if (ok && n > 0) {
+        res->iterations = n;
+        res->seconds = (double)(t1 - start) / 1e9;
+        res->ops_per_sec = (double)n / res->seconds;
+        qsort(lat, n, sizeof(*lat), cmp_u64);
+        res->p50_us = (double)lat[n / 2] / 1e3;
+        res->p99_us = (double)lat[(n * 99) / 100] / 1e3;
+    }
+    OPENSSL_free(lat);
+    return ok;
+}
+
+size_t bench_provider_algs(OSSL_PROVIDER *prov, int operation,
+                           const char **names, size_t n)
+{
+    const OSSL_ALGORITHM *algs;
+    int no_cache = 0;
+    size_t i;
+
+    algs = OSSL_PROVIDER_query_operation(prov, operation, &no_cache);
+    for (i = 0; algs != NULL && algs[i].algorithm_names != NULL && i < n; i++)
+        names[i] = algs[i].algorithm_names;
+    return i;
+}
+
+int bench_alg_selected(const char *algname, const char *filter)
+{
+    if (!alg_is_enabled(algname))
+        return 0;
+    return filter == NULL || strstr(algname, filter) != NULL;
+}
+
+/*
+ * Live heap accounting: every block carries its size in a header (sized
+ * to keep the alignment malloc() guarantees) so frees can be counted.
+ */
+#define MEM_HDR 16
+
+static _Atomic size_t mem_live_bytes, mem_live_blocks;
+static int mem_timed;
+static _Thread_local size_t tl_allocs;
+static _Thread_local uint64_t tl_alloc_ns;
+
+static void *mem_malloc(size_t num, const char *file, int line)
+{
+    uint64_t start = mem_timed ? bench_now_ns() : 0;
+    unsigned char *p = malloc(MEM_HDR + num);
+
+    (void)file;
+    (void)line;
+    if (mem_timed)
+        tl_alloc_ns += bench_now_ns() - start;
+    tl_allocs++;
+    if (p == NULL)
+        return NULL;
+    *(size_t *)p = num;
+    atomic_fetch_add(&mem_live_bytes, num);
+    atomic_fetch_add(&mem_live_blocks, 1);
+    return p + MEM_HDR;
+}
+
+static void mem_free(void *ptr, const char *file, int line)
+{
+    unsigned char *p = ptr;
+    uint64_t start;
+
+    (void)file;
+    (void)line;
+    if (p == NULL)
+        return;
+    p -= MEM_HDR;
+    atomic_fetch_sub(&mem_live_bytes, *(size_t *)p);
+    atomic_fetch_sub(&mem_live_blocks, 1);
+    start = mem_timed ? bench_now_ns() : 0;
+    free(p);
+    if (mem_timed)
+        tl_alloc_ns += bench_now_ns() - start;
+}
+
+static void *mem_realloc(void *ptr, size_t num, const char *file, int line)
+{
+    unsigned char *p;
+    size_t oldnum;
+
+    if (ptr == NULL)
+        return mem_malloc(num, file, line);
+    if (num == 0) {
+        mem_free(ptr, file, line);
+        return NULL;
+    }
+    if ((p = mem_malloc(num, file, line)) == NULL)
+        return NULL;
+    oldnum = *(size_t *)((unsigned char *)ptr - MEM_HDR);
+    memcpy(p, ptr, oldnum < num ? oldnum : num);
+    mem_free(ptr, file, line);
+    return p;
+}
+
+int bench_count_allocs(int timed)
+{
+    mem_timed = timed;
+    return CRYPTO_set_mem_functions(mem_malloc, mem_realloc, mem_free);
+}
+
+void bench_live_heap(size_t *bytes, size_t *blocks)
+{
+    *bytes = atomic_load(&mem_live_bytes);
+    *blocks = atomic_load(&mem_live_blocks);
+}
+
+void bench_thread_allocs(size_t *allocs, uint64_t *ns)
+{
+    *allocs = tl_allocs;
+    *ns = tl_alloc_ns;
+}
+
+void bench_thread_allocs_reset(void)
+{
+    tl_allocs = 0;
+    tl_alloc_ns = 0;
+}
@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+#ifndef OQSPROV_BENCH_COMMON_H
+#define OQSPROV_BENCH_COMMON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <openssl/provider.h>
+
+/* Operation to be measured; returns 1 on success */
+typedef int (*bench_fn)(void *arg);
+
+typedef struct {
+    size_t iterations;
+    double seconds;
+    double ops_per_sec;
+    double p50_us;
+    double p99_us;
+} bench_result;
+
+/* Monotonic clock in nanoseconds */
+uint64_t bench_now_ns(void);
+
+/*
+ * Calls fn(arg) repeatedly for at least min_seconds (and at least once),
+ * recording per-call latencies. Returns 0 if any call fails.
+ */
+int bench_run(bench_fn fn, void *arg, double min_seconds, bench_result *res);
+
+/*
+ * Fills names with the algorithm names the provider offers
+ * for the given OSSL_OP_* operation; returns their number (max n).
+ */
+size_t bench_provider_algs(OSSL_PROVIDER *prov, int operation,
+                           const char **names, size_t n);
+
+/* Applies the OQS_SKIP_TESTS list plus an optional substring filter */
+int bench_alg_selected(const char *algname, const char *filter);
+
+/*
+ * Installs OPENSSL_malloc() hooks counting heap use; must be called before
+ * anything is allocated. With timed set, the time spent in the allocator is
+ * measured as well, at the cost of two clock reads per call.
+ */
+int bench_count_allocs(int timed);
+
+/* Heap bytes and blocks currently allocated, by all threads */
+void bench_live_heap(size_t *bytes, size_t *blocks);
+
+/*
+ * Allocations (including reallocations) by the calling thread and the time
+ * it spent in the allocator since its last bench_thread_allocs_reset()
+ */
+void bench_thread_allocs(size_t *allocs, uint64_t *ns);
+void bench_thread_allocs_reset(void);
+
+#endif
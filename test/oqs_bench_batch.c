@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * Batch signature benchmark: for every signature algorithm offered by the
+ * provider, measures signatures/sec for signing a run of small messages
+ * with one key one EVP_PKEY_sign() call at a time (with a fresh context
+ * per message), in one "batch-sign" call run inline, and in one spread
+ * across the worker threads; and the same for verification.
+ *
+ * Usage: oqs_bench_batch <modulename> <configfile> [algfilter] [seconds]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/core_dispatch.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#include <openssl/provider.h>
+#include "bench_common.h"
+#include "oqs_batch.h"
+#include "test_common.h"
+
+#define NMSGS 64
+#define MSGLEN 32
+
+static OSSL_LIB_CTX *libctx = NULL;
+
+typedef struct {
+    EVP_PKEY *key;
+    size_t maxsiglen;
+    unsigned char msgs[NMSGS][MSGLEN];
+    unsigned char *sigs, *vsigs;
+    OQSPROV_BATCH_SIGN_ITEM sitems[NMSGS];
+    OQSPROV_BATCH_VERIFY_ITEM vitems[NMSGS];
+    int parallel;
+} batch_arg;
+
+static int bench_sign_each(void *varg)
+{
+    batch_arg *arg = varg;
+    EVP_PKEY_CTX *ctx;
+    size_t i, siglen;
+    int ret = 1;
+
+    for (i = 0; ret && i < NMSGS; i++) {
+        siglen = arg->maxsiglen;
+        ret = (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, arg->key, NULL)) != NULL
+              && EVP_PKEY_sign_init(ctx) > 0
+              && EVP_PKEY_sign(ctx, arg->sigs + i * arg->maxsiglen, &siglen,
+                               arg->msgs[i], MSGLEN) > 0;
+        EVP_PKEY_CTX_free(ctx);
+    }
+    return ret;
+}
+
+static int bench_sign_batch(void *varg)
+{
+    batch_arg *arg = varg;
+    OQSPROV_BATCH_SIGN batch = { arg->sitems, NMSGS, arg->parallel, 0 };
+    void *pbatch = &batch;
+    OSSL_PARAM params[2];
+    EVP_PKEY_CTX *ctx;
+    size_t i;
+    int ret;
+
+    for (i = 0; i < NMSGS; i++)
+        arg->sitems[i].siglen = arg->maxsiglen;
+    params[0] = OSSL_PARAM_construct_octet_ptr(OQSPROV_PARAM_BATCH_SIGN,
+                                               &pbatch, sizeof(batch));
+    params[1] = OSSL_PARAM_construct_end();
+    ret = (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, arg->key, NULL)) != NULL
+          && EVP_PKEY_sign_init(ctx) > 0
+          && EVP_PKEY_CTX_set_params(ctx, params) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+static int bench_verify_each(void *varg)
+{
+    batch_arg *arg = varg;
+    EVP_PKEY_CTX *ctx;
+    size_t i;
+    int ret = 1;
+
+    for (i = 0; ret && i < NMSGS; i++) {
+        ret = (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, arg->key, NULL)) != NULL
+              && EVP_PKEY_verify_init(ctx) > 0
+              && EVP_PKEY_verify(ctx, arg->vitems[i].sig, arg->vitems[i].siglen,
+                                 arg->msgs[i], MSGLEN) > 0;
+        EVP_PKEY_CTX_free(ctx);
+    }
+    return ret;
+}
+
+static int bench_verify_batch(void *varg)
+{
+    batch_arg *arg = varg;
+    unsigned char results[(NMSGS + 7) / 8];
+    OQSPROV_BATCH_VERIFY batch = { arg->vitems, NMSGS, results, 0 };
+    void *pbatch = &batch;
+    OSSL_PARAM params[2];
+    EVP_PKEY_CTX *ctx;
+    int ret;
+
+    params[0] = OSSL_PARAM_construct_octet_ptr(OQSPROV_PARAM_BATCH_VERIFY,
+                                               &pbatch, sizeof(batch));
+    params[1] = OSSL_PARAM_construct_end();
+    ret = (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, arg->key, NULL)) != NULL
+          && EVP_PKEY_verify_init(ctx) > 0
+          && EVP_PKEY_CTX_set_params(ctx, params) > 0
+          && batch.nverified == NMSGS;
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+static int setup(batch_arg *arg, const char *alg)
+{
+    EVP_PKEY_CTX *ctx;
+    size_t i;
+    int ret;
+
+    ret = (ctx = EVP_PKEY_CTX_new_from_name(libctx, alg, NULL)) != NULL
+          && EVP_PKEY_keygen_init(ctx) > 0
+          && EVP_PKEY_generate(ctx, &arg->key) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    if (!ret)
+        return 0;
+    arg->maxsiglen = EVP_PKEY_get_size(arg->key);
+    if ((arg->sigs = OPENSSL_malloc(NMSGS * arg->maxsiglen)) == NULL
+        || (arg->vsigs = OPENSSL_malloc(NMSGS * arg->maxsiglen)) == NULL)
+        return 0;
+    for (i = 0; i < NMSGS; i++) {
+        memset(arg->msgs[i], (int)i, MSGLEN);
+        arg->sitems[i].tbs = arg->msgs[i];
+        arg->sitems[i].tbslen = MSGLEN;
+        arg->sitems[i].sig = arg->sigs + i * arg->maxsiglen;
+    }
+    /*
+     * one inline batch provides the signatures to verify; they are copied
+     * as the signing benchmarks overwrite them, possibly changing their
+     * length (e.g. for ECDSA)
+     */
+    arg->parallel = 0;
+    if (!bench_sign_batch(arg))
+        return 0;
+    for (i = 0; i < NMSGS; i++) {
+        arg->vitems[i].key = NULL;
+        arg->vitems[i].tbs = arg->msgs[i];
+        arg->vitems[i].tbslen = MSGLEN;
+        memcpy(arg->vsigs + i * arg->maxsiglen, arg->sitems[i].sig,
+               arg->sitems[i].siglen);
+        arg->vitems[i].sig = arg->vsigs + i * arg->maxsiglen;
+        arg->vitems[i].siglen = arg->sitems[i].siglen;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    OSSL_PROVIDER *prov;
+    const char *algs[256], *filter = NULL;
+    double seconds = 0.2;
+    size_t i, nalgs;
+    int errcnt = 0;
+
+    T((libctx = OSSL_LIB_CTX_new()) != NULL);
+    T(argc >= 3);
+    T(OSSL_LIB_CTX_load_config(libctx, argv[2]));
+    T((prov = OSSL_PROVIDER_load(libctx, argv[1])) != NULL);
+    if (argc > 3)
+        filter = argv[3];
+    if (argc > 4)
+        seconds = atof(argv[4]);
+
+    nalgs = bench_provider_algs(prov, OSSL_OP_SIGNATURE, algs, sizeof(algs)/sizeof(algs[0]));
+    printf("%-28s %11s %11s %11s %11s %11s\n", "algorithm", "sign/s",
+           "batch/s", "parallel/s", "verify/s", "vbatch/s");
+    for (i = 0; i < nalgs; i++) {
+        batch_arg *arg;
+        bench_result each, serial, parallel, veach, vbatch;
+
+        if (!bench_alg_selected(algs[i], filter))
+            continue;
+        if ((arg = OPENSSL_zalloc(sizeof(*arg))) == NULL || !setup(arg, algs[i])) {
+            fprintf(stderr, cRED "  Benchmark setup failed: %s" cNORM "\n", algs[i]);
+            ERR_print_errors_fp(stderr);
+            errcnt++;
+            goto next;
+        }
+        if (!bench_run(bench_sign_each, arg, seconds, &each)
+            || (arg->parallel = 0, !bench_run(bench_sign_batch, arg, seconds, &serial))
+            || (arg->parallel = 1, !bench_run(bench_sign_batch, arg, seconds, &parallel))
+            || !bench_run(bench_verify_each, arg, seconds, &veach)
+            || !bench_run(bench_verify_batch, arg, seconds, &vbatch)) {
+            fprintf(stderr, cRED "  Benchmark failed: %s" cNORM "\n", algs[i]);
+            ERR_print_errors_fp(stderr);
+            errcnt++;
+            goto next;
+        }
+        /* each run handles NMSGS messages */
+        printf("%-28s %11.1f %11.1f %11.1f %11.1f %11.1f\n", algs[i],
+               each.ops_per_sec * NMSGS, serial.ops_per_sec * NMSGS,
+               parallel.ops_per_sec * NMSGS, veach.ops_per_sec * NMSGS,
+               vbatch.ops_per_sec * NMSGS);
+ next:
+        if (arg != NULL) {
+            EVP_PKEY_free(arg->key);
+            OPENSSL_free(arg->sigs);
+            OPENSSL_free(arg->vsigs);
+            OPENSSL_free(arg);
+        }
+    }
+
+    OSSL_PROVIDER_unload(prov);
+    OSSL_LIB_CTX_free(libctx);
+    return errcnt != 0;
+}
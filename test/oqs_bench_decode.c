@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * Key loading benchmark: for every signature algorithm offered by the
+ * provider, measures loads/sec of PEM and DER encoded private keys
+ * (PrivateKeyInfo), public keys (SubjectPublicKeyInfo) and self-signed
+ * certificates, each decoded into a usable key as done when a server
+ * loads its credentials or a client parses a peer certificate.
+ *
+ * Usage: oqs_bench_decode <modulename> <configfile> [algfilter] [seconds]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/core_dispatch.h>
+#include <openssl/decoder.h>
+#include <openssl/encoder.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/provider.h>
+#include <openssl/x509.h>
+#include "bench_common.h"
+#include "test_common.h"
+
+static OSSL_LIB_CTX *libctx = NULL;
+
+enum { PRIV_PEM, PRIV_DER, PUB_PEM, PUB_DER, CERT_PEM, CERT_DER, NINPUTS };
+
+static const char *input_names[NINPUTS] = {
+    "priv pem/s", "priv der/s", "pub pem/s", "pub der/s", "cert pem/s", "cert der/s"
+};
+
+typedef struct {
+    int input;
+    unsigned char *data[NINPUTS];
+    size_t datalen[NINPUTS];
+} decode_arg;
+
+static int bench_decode_key(void *varg)
+{
+    decode_arg *arg = varg;
+    int priv = arg->input == PRIV_PEM || arg->input == PRIV_DER;
+    int pem = arg->input == PRIV_PEM || arg->input == PUB_PEM;
+    const unsigned char *data = arg->data[arg->input];
+    size_t datalen = arg->datalen[arg->input];
+    OSSL_DECODER_CTX *dctx;
+    EVP_PKEY *key = NULL;
+    int ret;
+
+    ret = (dctx = OSSL_DECODER_CTX_new_for_pkey(&key, pem ? "PEM" : "DER", NULL, NULL,
+                                                priv ? EVP_PKEY_KEYPAIR : EVP_PKEY_PUBLIC_KEY,
+                                                libctx, NULL)) != NULL
+          && OSSL_DECODER_from_data(dctx, &data, &datalen)
+          && key != NULL;
+    OSSL_DECODER_CTX_free(dctx);
+    EVP_PKEY_free(key);
+    return ret;
+}
+
+static int bench_decode_cert(void *varg)
+{
+    decode_arg *arg = varg;
+    const unsigned char *data = arg->data[arg->input];
+    X509 *cert;
+    BIO *bio = NULL;
+    int ret;
+
+    if ((cert = X509_new_ex(libctx, NULL)) == NULL)
+        return 0;
+    if (arg->input == CERT_PEM)
+        ret = (bio = BIO_new_mem_buf(data, arg->datalen[arg->input])) != NULL
+              && PEM_read_bio_X509(bio, &cert, NULL, NULL) != NULL;
+    else
+        ret = d2i_X509(&cert, &data, arg->datalen[arg->input]) != NULL;
+    ret = ret && X509_get0_pubkey(cert) != NULL;
+    BIO_free(bio);
+    X509_free(cert);
+    return ret;
+}
+
+static int encode_key(EVP_PKEY *key, decode_arg *arg, int input)
+{
+    int priv = input == PRIV_PEM || input == PRIV_DER;
+    int pem = input == PRIV_PEM || input == PUB_PEM;
+    OSSL_ENCODER_CTX *ectx;
+    int ret;
+
+    ret = (ectx = OSSL_ENCODER_CTX_new_for_pkey(key,
+                                                priv ? EVP_PKEY_KEYPAIR : EVP_PKEY_PUBLIC_KEY,
+                                                pem ? "PEM" : "DER",
+                                                priv ? "PrivateKeyInfo" : "SubjectPublicKeyInfo",
+                                                NULL)) != NULL
+          && OSSL_ENCODER_to_data(ectx, &arg->data[input], &arg->datalen[input]);
+    OSSL_ENCODER_CTX_free(ectx);
+    return ret;
+}
+
+static int encode_cert(EVP_PKEY *key, decode_arg *arg)
+{
+    X509 *cert;
+    X509_NAME *name;
+    BIO *bio = NULL;
+    BUF_MEM *mem;
+    unsigned char *der = NULL;
+    int derlen = 0, ret;
+
+    ret = (cert = X509_new_ex(libctx, NULL)) != NULL
+          && X509_set_version(cert, X509_VERSION_3)
+          && ASN1_INTEGER_set(X509_get_serialNumber(cert), 1)
+          && X509_gmtime_adj(X509_getm_notBefore(cert), 0) != NULL
+          && X509_gmtime_adj(X509_getm_notAfter(cert), 86400) != NULL
+          && (name = X509_get_subject_name(cert)) != NULL
+          && X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                        (const unsigned char *)"oqs_bench_decode",
+                                        -1, -1, 0)
+          && X509_set_issuer_name(cert, name)
+          && X509_set_pubkey(cert, key)
+          && X509_sign(cert, key, NULL) > 0
+          && (derlen = i2d_X509(cert, &der)) > 0
+          && (bio = BIO_new(BIO_s_mem())) != NULL
+          && PEM_write_bio_X509(bio, cert)
+          && BIO_get_mem_ptr(bio, &mem) > 0
+          && (arg->data[CERT_PEM] = OPENSSL_memdup(mem->data, mem->length)) != NULL;
+    if (ret) {
+        arg->datalen[CERT_PEM] = mem->length;
+        arg->data[CERT_DER] = der;
+        arg->datalen[CERT_DER] = derlen;
+        der = NULL;
+    }
+    OPENSSL_free(der);
+    BIO_free(bio);
+    X509_free(cert);
+    return ret;
+}
+
+static int setup(const char *alg, decode_arg *arg)
+{
+    EVP_PKEY_CTX *ctx;
+    EVP_PKEY *key = NULL;
+    int ret, input;
+
+    ret = (ctx = EVP_PKEY_CTX_new_from_name(libctx, alg, NULL)) != NULL
+          && EVP_PKEY_keygen_init(ctx) > 0
+          && EVP_PKEY_generate(ctx, &key) > 0;
+    for (input = PRIV_PEM; ret && input <= PUB_DER; input++)
+        ret = encode_key(key, arg, input);
+    ret = ret && encode_cert(key, arg);
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    OSSL_PROVIDER *prov;
+    const char *algs[256], *filter = NULL;
+    double seconds = 0.2;
+    size_t i, nalgs;
+    int errcnt = 0, input;
+
+    T((libctx = OSSL_LIB_CTX_new()) != NULL);
+    T(argc >= 3);
+    T(OSSL_LIB_CTX_load_config(libctx, argv[2]));
+    T((prov = OSSL_PROVIDER_load(libctx, argv[1])) != NULL);
+    if (argc > 3)
+        filter = argv[3];
+    if (argc > 4)
+        seconds = atof(argv[4]);
+
+    nalgs = bench_provider_algs(prov, OSSL_OP_SIGNATURE, algs, sizeof(algs)/sizeof(algs[0]));
+    printf("%-36s", "algorithm");
+    for (input = 0; input < NINPUTS; input++)
+        printf(" %11s", input_names[input]);
+    printf("\n");
+    for (i = 0; i < nalgs; i++) {
+        decode_arg arg;
+        bench_result res[NINPUTS];
+
+        if (!bench_alg_selected(algs[i], filter))
+            continue;
+        memset(&arg, 0, sizeof(arg));
+        if (!setup(algs[i], &arg)) {
+            fprintf(stderr, cRED "  Benchmark setup failed: %s" cNORM "\n", algs[i]);
+            ERR_print_errors_fp(stderr);
+            errcnt++;
+            goto next;
+        }
+        for (input = 0; input < NINPUTS; input++) {
+            arg.input = input;
+            if (!bench_run(input < CERT_PEM ? bench_decode_key : bench_decode_cert,
+                           &arg, seconds, &res[input])) {
+                fprintf(stderr, cRED "  Benchmark failed: %s (%s)" cNORM "\n",
+                        algs[i], input_names[input]);
+                ERR_print_errors_fp(stderr);
+                errcnt++;
+                goto next;
+            }
+        }
+        printf("%-36s", algs[i]);
+        for (input = 0; input < NINPUTS; input++)
+            printf(" %11.1f", res[input].ops_per_sec);
+        printf("\n");
+ next:
+        for (input = 0; input < NINPUTS; input++)
+            OPENSSL_free(arg.data[input]);
+    }
+
+    OSSL_PROVIDER_unload(prov);
+    OSSL_LIB_CTX_free(libctx);
+    return errcnt != 0;
+}
@@ -0,0 +1,366 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * KEM benchmark: for every KEM offered by the provider, measures the
+ * latency of encapsulation, decapsulation and of a complete key exchange
+ * (client keygen, server encaps, client decaps) as done in a TLS
+ * handshake, once with the classical and PQ halves of hybrids run one
+ * after the other and once with them run concurrently ("hybrid-parallel").
+ * Key generation is measured as well.
+ *
+ * For comparison, the same operations of the (PQ half of the) algorithm
+ * are run by calling liboqs directly on preallocated buffers; the
+ * "overhead" row is the difference to the serial mode, i.e. what the
+ * EVP and provider layers (contexts, key objects, parameter handling,
+ * allocations) add. For hybrids, it includes the classical half.
+ *
+ * Usage: oqs_bench_kem <modulename> <configfile> [algfilter] [seconds]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/core_dispatch.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#include <openssl/provider.h>
+#include "bench_common.h"
+#include "test_common.h"
+#include "oqs/oqs.h"
+
+static OSSL_LIB_CTX *libctx = NULL;
+
+/* liboqs algorithm of each KEM */
+static const struct {
+    const char *name;
+    const char *oqs_alg;
+} kem_oqs_names[] = {
+///// OQS_TEMPLATE_FRAGMENT_KEM_OQS_NAMES_START
+#ifdef OQS_ENABLE_KEM_frodokem_640_aes
+    { "frodo640aes", OQS_KEM_alg_frodokem_640_aes },
+#endif
+#ifdef OQS_ENABLE_KEM_frodokem_640_shake
+    { "frodo640shake", OQS_KEM_alg_frodokem_640_shake },
+#endif
+#ifdef OQS_ENABLE_KEM_frodokem_976_aes
+    { "frodo976aes", OQS_KEM_alg_frodokem_976_aes },
+#endif
+#ifdef OQS_ENABLE_KEM_frodokem_976_shake
+    { "frodo976shake", OQS_KEM_alg_frodokem_976_shake },
+#endif
+#ifdef OQS_ENABLE_KEM_frodokem_1344_aes
+    { "frodo1344aes", OQS_KEM_alg_frodokem_1344_aes },
+#endif
+#ifdef OQS_ENABLE_KEM_frodokem_1344_shake
+    { "frodo1344shake", OQS_KEM_alg_frodokem_1344_shake },
+#endif
+#ifdef OQS_ENABLE_KEM_kyber_512
+    { "kyber512", OQS_KEM_alg_kyber_512 },
+#endif
+#ifdef OQS_ENABLE_KEM_kyber_768
+    { "kyber768", OQS_KEM_alg_kyber_768 },
+#endif
+#ifdef OQS_ENABLE_KEM_kyber_1024
+    { "kyber1024", OQS_KEM_alg_kyber_1024 },
+#endif
+#ifdef OQS_ENABLE_KEM_bike_l1
+    { "bikel1", OQS_KEM_alg_bike_l1 },
+#endif
+#ifdef OQS_ENABLE_KEM_bike_l3
+    { "bikel3", OQS_KEM_alg_bike_l3 },
+#endif
+#ifdef OQS_ENABLE_KEM_kyber_512_90s
+    { "kyber90s512", OQS_KEM_alg_kyber_512_90s },
+#endif
+#ifdef OQS_ENABLE_KEM_kyber_768_90s
+    { "kyber90s768", OQS_KEM_alg_kyber_768_90s },
+#endif
+#ifdef OQS_ENABLE_KEM_kyber_1024_90s
+    { "kyber90s1024", OQS_KEM_alg_kyber_1024_90s },
+#endif
+#ifdef OQS_ENABLE_KEM_hqc_128
+    { "hqc128", OQS_KEM_alg_hqc_128 },
+#endif
+#ifdef OQS_ENABLE_KEM_hqc_192
+    { "hqc192", OQS_KEM_alg_hqc_192 },
+#endif
+#ifdef OQS_ENABLE_KEM_hqc_256
+    { "hqc256", OQS_KEM_alg_hqc_256 },
+#endif
+///// OQS_TEMPLATE_FRAGMENT_KEM_OQS_NAMES_END
+};
+
+typedef struct {
+    const char *alg;
+    EVP_PKEY *key;
+    unsigned char *ct, *secret;
+    size_t ctlen, secretlen;
+    OSSL_PARAM params[2];
+} kem_arg;
+
+static int encaps(kem_arg *arg, EVP_PKEY *key, unsigned char *ct, unsigned char *secret)
+{
+    EVP_PKEY_CTX *ctx;
+    size_t ctlen = arg->ctlen, secretlen = arg->secretlen;
+    int ret;
+
+    ret = (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, key, NULL)) != NULL
+          && EVP_PKEY_encapsulate_init(ctx, arg->params) > 0
+          && EVP_PKEY_encapsulate(ctx, ct, &ctlen, secret, &secretlen) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+static int decaps(kem_arg *arg, EVP_PKEY *key, const unsigned char *ct, unsigned char *secret)
+{
+    EVP_PKEY_CTX *ctx;
+    size_t secretlen = arg->secretlen;
+    int ret;
+
+    ret = (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, key, NULL)) != NULL
+          && EVP_PKEY_decapsulate_init(ctx, arg->params) > 0
+          && EVP_PKEY_decapsulate(ctx, secret, &secretlen, ct, arg->ctlen) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+typedef struct {
+    OQS_KEM *kem;
+    uint8_t *pk, *sk, *ct, *ss, *ss2;
+} oqs_arg;
+
+static int bench_keygen(void *varg)
+{
+    kem_arg *arg = varg;
+    EVP_PKEY_CTX *ctx;
+    EVP_PKEY *key = NULL;
+    int ret;
+
+    ret = (ctx = EVP_PKEY_CTX_new_from_name(libctx, arg->alg, NULL)) != NULL
+          && EVP_PKEY_keygen_init(ctx) > 0
+          && EVP_PKEY_generate(ctx, &key) > 0;
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+static int bench_encaps(void *varg)
+{
+    kem_arg *arg = varg;
+    unsigned char *ct = OPENSSL_malloc(arg->ctlen);
+    unsigned char *secret = OPENSSL_malloc(arg->secretlen);
+    int ret;
+
+    ret = ct != NULL && secret != NULL && encaps(arg, arg->key, ct, secret);
+    OPENSSL_free(ct);
+    OPENSSL_free(secret);
+    return ret;
+}
+
+static int bench_decaps(void *varg)
+{
+    kem_arg *arg = varg;
+    unsigned char *secret = OPENSSL_malloc(arg->secretlen);
+    int ret;
+
+    ret = secret != NULL && decaps(arg, arg->key, arg->ct, secret);
+    OPENSSL_free(secret);
+    return ret;
+}
+
+static int bench_handshake(void *varg)
+{
+    kem_arg *arg = varg;
+    EVP_PKEY_CTX *ctx = NULL;
+    EVP_PKEY *key = NULL;
+    unsigned char *ct = OPENSSL_malloc(arg->ctlen);
+    unsigned char *secenc = OPENSSL_malloc(arg->secretlen);
+    unsigned char *secdec = OPENSSL_malloc(arg->secretlen);
+    int ret;
+
+    ret = ct != NULL && secenc != NULL && secdec != NULL
+          && (ctx = EVP_PKEY_CTX_new_from_name(libctx, arg->alg, NULL)) != NULL
+          && EVP_PKEY_keygen_init(ctx) > 0
+          && EVP_PKEY_generate(ctx, &key) > 0
+          && encaps(arg, key, ct, secenc)
+          && decaps(arg, key, ct, secdec)
+          && memcmp(secenc, secdec, arg->secretlen) == 0;
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_free(key);
+    OPENSSL_free(ct);
+    OPENSSL_free(secenc);
+    OPENSSL_free(secdec);
+    return ret;
+}
+
+static int bench_oqs_keygen(void *varg)
+{
+    oqs_arg *arg = varg;
+
+    return OQS_KEM_keypair(arg->kem, arg->pk, arg->sk) == OQS_SUCCESS;
+}
+
+static int bench_oqs_encaps(void *varg)
+{
+    oqs_arg *arg = varg;
+
+    return OQS_KEM_encaps(arg->kem, arg->ct, arg->ss, arg->pk) == OQS_SUCCESS;
+}
+
+static int bench_oqs_decaps(void *varg)
+{
+    oqs_arg *arg = varg;
+
+    return OQS_KEM_decaps(arg->kem, arg->ss2, arg->ct, arg->sk) == OQS_SUCCESS;
+}
+
+static int bench_oqs_handshake(void *varg)
+{
+    oqs_arg *arg = varg;
+
+    return OQS_KEM_keypair(arg->kem, arg->pk, arg->sk) == OQS_SUCCESS
+           && OQS_KEM_encaps(arg->kem, arg->ct, arg->ss, arg->pk) == OQS_SUCCESS
+           && OQS_KEM_decaps(arg->kem, arg->ss2, arg->ct, arg->sk) == OQS_SUCCESS
+           && memcmp(arg->ss, arg->ss2, arg->kem->length_shared_secret) == 0;
+}
+
+/* sets up arg for the liboqs algorithm of alg or its PQ half */
+static int setup_oqs(const char *alg, oqs_arg *arg)
+{
+    const char *pqname = strchr(alg, '_') != NULL ? strchr(alg, '_') + 1 : alg;
+    size_t i;
+
+    for (i = 0; i < sizeof(kem_oqs_names)/sizeof(kem_oqs_names[0]); i++)
+        if (strcmp(kem_oqs_names[i].name, pqname) == 0)
+            break;
+    if (i == sizeof(kem_oqs_names)/sizeof(kem_oqs_names[0])
+        || (arg->kem = OQS_KEM_new(kem_oqs_names[i].oqs_alg)) == NULL)
+        return 0;
+    return (arg->pk = OPENSSL_malloc(arg->kem->length_public_key)) != NULL
+           && (arg->sk = OPENSSL_malloc(arg->kem->length_secret_key)) != NULL
+           && (arg->ct = OPENSSL_malloc(arg->kem->length_ciphertext)) != NULL
+           && (arg->ss = OPENSSL_malloc(arg->kem->length_shared_secret)) != NULL
+           && (arg->ss2 = OPENSSL_malloc(arg->kem->length_shared_secret)) != NULL
+           && bench_oqs_keygen(arg)
+           && bench_oqs_encaps(arg);
+}
+
+static void free_oqs(oqs_arg *arg)
+{
+    OPENSSL_free(arg->pk);
+    OPENSSL_free(arg->sk);
+    OPENSSL_free(arg->ct);
+    OPENSSL_free(arg->ss);
+    OPENSSL_free(arg->ss2);
+    OQS_KEM_free(arg->kem);
+}
+
+static void print_row(const char *alg, const char *mode, double keygen, double enc,
+                      double dec, double hs50, double hs99)
+{
+    printf("%-28s %-8s %12.1f %12.1f %12.1f %14.1f %14.1f\n", alg, mode,
+           keygen, enc, dec, hs50, hs99);
+}
+
+static int setup(kem_arg *arg)
+{
+    EVP_PKEY_CTX *ctx;
+    int ret;
+
+    ret = (ctx = EVP_PKEY_CTX_new_from_name(libctx, arg->alg, NULL)) != NULL
+          && EVP_PKEY_keygen_init(ctx) > 0
+          && EVP_PKEY_generate(ctx, &arg->key) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    ctx = NULL;
+    ret = ret
+          && (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, arg->key, NULL)) != NULL
+          && EVP_PKEY_encapsulate_init(ctx, NULL) > 0
+          && EVP_PKEY_encapsulate(ctx, NULL, &arg->ctlen, NULL, &arg->secretlen) > 0
+          && (arg->ct = OPENSSL_malloc(arg->ctlen)) != NULL
+          && (arg->secret = OPENSSL_malloc(arg->secretlen)) != NULL
+          && EVP_PKEY_encapsulate(ctx, arg->ct, &arg->ctlen, arg->secret, &arg->secretlen) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *modes[] = { "serial", "parallel" };
+    OSSL_PROVIDER *prov;
+    const char *algs[256], *filter = NULL;
+    double seconds = 0.2;
+    size_t i, nalgs;
+    int errcnt = 0, mode;
+
+    T((libctx = OSSL_LIB_CTX_new()) != NULL);
+    T(argc >= 3);
+    T(OSSL_LIB_CTX_load_config(libctx, argv[2]));
+    T((prov = OSSL_PROVIDER_load(libctx, argv[1])) != NULL);
+    if (argc > 3)
+        filter = argv[3];
+    if (argc > 4)
+        seconds = atof(argv[4]);
+
+    nalgs = bench_provider_algs(prov, OSSL_OP_KEM, algs, sizeof(algs)/sizeof(algs[0]));
+    printf("%-28s %-8s %12s %12s %12s %14s %14s\n", "algorithm", "mode", "keygen p50us",
+           "encaps p50us", "decaps p50us", "exchange p50us", "exchange p99us");
+    for (i = 0; i < nalgs; i++) {
+        kem_arg arg;
+        oqs_arg oarg;
+        bench_result gen, enc[2], dec[2], hs[2], ogen, oenc, odec, ohs;
+
+        if (!bench_alg_selected(algs[i], filter))
+            continue;
+        memset(&arg, 0, sizeof(arg));
+        memset(&oarg, 0, sizeof(oarg));
+        arg.alg = algs[i];
+        if (!setup(&arg) || !setup_oqs(algs[i], &oarg)) {
+            fprintf(stderr, cRED "  Benchmark setup failed: %s" cNORM "\n", algs[i]);
+            ERR_print_errors_fp(stderr);
+            errcnt++;
+            goto next;
+        }
+        if (!bench_run(bench_keygen, &arg, seconds, &gen)) {
+            fprintf(stderr, cRED "  Benchmark failed: %s (keygen)" cNORM "\n", algs[i]);
+            ERR_print_errors_fp(stderr);
+            errcnt++;
+            goto next;
+        }
+        for (mode = 0; mode < 2; mode++) {
+            arg.params[0] = OSSL_PARAM_construct_int("hybrid-parallel", &mode);
+            arg.params[1] = OSSL_PARAM_construct_end();
+            if (!bench_run(bench_encaps, &arg, seconds, &enc[mode])
+                || !bench_run(bench_decaps, &arg, seconds, &dec[mode])
+                || !bench_run(bench_handshake, &arg, seconds, &hs[mode])) {
+                fprintf(stderr, cRED "  Benchmark failed: %s (%s)" cNORM "\n",
+                        algs[i], modes[mode]);
+                ERR_print_errors_fp(stderr);
+                errcnt++;
+                goto next;
+            }
+            print_row(algs[i], modes[mode], gen.p50_us, enc[mode].p50_us,
+                      dec[mode].p50_us, hs[mode].p50_us, hs[mode].p99_us);
+        }
+        if (!bench_run(bench_oqs_keygen, &oarg, seconds, &ogen)
+            || !bench_run(bench_oqs_encaps, &oarg, seconds, &oenc)
+            || !bench_run(bench_oqs_decaps, &oarg, seconds, &odec)
+            || !bench_run(bench_oqs_handshake, &oarg, seconds, &ohs)) {
+            fprintf(stderr, cRED "  Benchmark failed: %s (liboqs)" cNORM "\n", algs[i]);
+            errcnt++;
+            goto next;
+        }
+        print_row(algs[i], "liboqs", ogen.p50_us, oenc.p50_us, odec.p50_us,
+                  ohs.p50_us, ohs.p99_us);
+        print_row(algs[i], "overhead", gen.p50_us - ogen.p50_us,
+                  enc[0].p50_us - oenc.p50_us, dec[0].p50_us - odec.p50_us,
+                  hs[0].p50_us - ohs.p50_us, hs[0].p99_us - ohs.p99_us);
+ next:
+        EVP_PKEY_free(arg.key);
+        OPENSSL_free(arg.ct);
+        OPENSSL_free(arg.secret);
+        free_oqs(&oarg);
+    }
+
+    OSSL_PROVIDER_unload(prov);
+    OSSL_LIB_CTX_free(libctx);
+    return errcnt != 0;
+}
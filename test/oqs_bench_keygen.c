@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * Key construction benchmark: for every key type offered by the provider,
+ * measures keys/sec for generating fresh keys (as done for each ephemeral
+ * TLS key share) and for importing a public key (as done for each peer
+ * key share). It also reports the time the keygen-validation levels
+ * "classical" and "full" add to generating a key, over "off", and the heap
+ * memory and number of allocations held by each generated key, as counted
+ * by OPENSSL_malloc() hooks. keygen/s uses the configured default policy.
+ *
+ * Usage: oqs_bench_keygen <modulename> <configfile> [algfilter] [seconds]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/core_dispatch.h>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/provider.h>
+#include "bench_common.h"
+#include "test_common.h"
+
+static OSSL_LIB_CTX *libctx = NULL;
+
+#define NMEMKEYS 8
+
+typedef struct {
+    const char *alg;
+    unsigned char *pub;
+    size_t publen;
+    const char *validation;  /* NULL for the configured default */
+} keygen_arg;
+
+static int bench_keygen(void *varg)
+{
+    keygen_arg *arg = varg;
+    EVP_PKEY_CTX *ctx;
+    EVP_PKEY *key = NULL;
+    OSSL_PARAM params[2];
+    int ret;
+
+    params[0] = OSSL_PARAM_construct_utf8_string("keygen-validation",
+                                                 (char *)arg->validation, 0);
+    params[1] = OSSL_PARAM_construct_end();
+    ret = (ctx = EVP_PKEY_CTX_new_from_name(libctx, arg->alg, NULL)) != NULL
+          && EVP_PKEY_keygen_init(ctx) > 0
+          && (arg->validation == NULL || EVP_PKEY_CTX_set_params(ctx, params) > 0)
+          && EVP_PKEY_generate(ctx, &key) > 0;
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+/* microseconds validation adds to generating a key, over "off" */
+static int bench_validation(keygen_arg *arg, double seconds, double *classical_us,
+                            double *full_us)
+{
+    bench_result off, classical, full;
+    int ret;
+
+    arg->validation = "off";
+    ret = bench_run(bench_keygen, arg, seconds, &off);
+    arg->validation = "classical";
+    ret = ret && bench_run(bench_keygen, arg, seconds, &classical);
+    arg->validation = "full";
+    ret = ret && bench_run(bench_keygen, arg, seconds, &full);
+    arg->validation = NULL;
+    if (ret) {
+        *classical_us = 1e6 / classical.ops_per_sec - 1e6 / off.ops_per_sec;
+        *full_us = 1e6 / full.ops_per_sec - 1e6 / off.ops_per_sec;
+    }
+    return ret;
+}
+
+static int bench_import_public(void *varg)
+{
+    keygen_arg *arg = varg;
+    EVP_PKEY_CTX *ctx;
+    EVP_PKEY *key = NULL;
+    OSSL_PARAM params[2];
+    int ret;
+
+    params[0] = OSSL_PARAM_construct_octet_string(OSSL_PKEY_PARAM_PUB_KEY,
+                                                  arg->pub, arg->publen);
+    params[1] = OSSL_PARAM_construct_end();
+    ret = (ctx = EVP_PKEY_CTX_new_from_name(libctx, arg->alg, NULL)) != NULL
+          && EVP_PKEY_fromdata_init(ctx) > 0
+          && EVP_PKEY_fromdata(ctx, &key, EVP_PKEY_PUBLIC_KEY, params) > 0;
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+/* heap bytes and blocks held per generated key */
+static int key_footprint(keygen_arg *arg, double *bytes, double *blocks)
+{
+    EVP_PKEY_CTX *ctx;
+    EVP_PKEY *keys[NMEMKEYS] = { NULL };
+    size_t live_bytes, live_blocks, end_bytes, end_blocks, i;
+    int ret;
+
+    ret = (ctx = EVP_PKEY_CTX_new_from_name(libctx, arg->alg, NULL)) != NULL
+          && EVP_PKEY_keygen_init(ctx) > 0;
+    // warm up shared state, e.g. cached key parameters
+    ret = ret && EVP_PKEY_generate(ctx, &keys[0]) > 0;
+    EVP_PKEY_free(keys[0]);
+    keys[0] = NULL;
+    bench_live_heap(&live_bytes, &live_blocks);
+    for (i = 0; ret && i < NMEMKEYS; i++)
+        ret = EVP_PKEY_generate(ctx, &keys[i]) > 0;
+    bench_live_heap(&end_bytes, &end_blocks);
+    *bytes = ((double)end_bytes - live_bytes) / NMEMKEYS;
+    *blocks = ((double)end_blocks - live_blocks) / NMEMKEYS;
+    for (i = 0; i < NMEMKEYS; i++)
+        EVP_PKEY_free(keys[i]);
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+static int get_public_key(keygen_arg *arg)
+{
+    EVP_PKEY_CTX *ctx;
+    EVP_PKEY *key = NULL;
+    int ret;
+
+    ret = (ctx = EVP_PKEY_CTX_new_from_name(libctx, arg->alg, NULL)) != NULL
+          && EVP_PKEY_keygen_init(ctx) > 0
+          && EVP_PKEY_generate(ctx, &key) > 0
+          && EVP_PKEY_get_octet_string_param(key, OSSL_PKEY_PARAM_PUB_KEY,
+                                             NULL, 0, &arg->publen)
+          && (arg->pub = OPENSSL_malloc(arg->publen)) != NULL
+          && EVP_PKEY_get_octet_string_param(key, OSSL_PKEY_PARAM_PUB_KEY,
+                                             arg->pub, arg->publen, &arg->publen);
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    OSSL_PROVIDER *prov;
+    const char *algs[256], *filter = NULL;
+    double seconds = 0.2;
+    size_t i, nalgs;
+    int errcnt = 0;
+
+    // before anything gets allocated
+    T(bench_count_allocs(0));
+    T((libctx = OSSL_LIB_CTX_new()) != NULL);
+    T(argc >= 3);
+    T(OSSL_LIB_CTX_load_config(libctx, argv[2]));
+    T((prov = OSSL_PROVIDER_load(libctx, argv[1])) != NULL);
+    if (argc > 3)
+        filter = argv[3];
+    if (argc > 4)
+        seconds = atof(argv[4]);
+
+    nalgs = bench_provider_algs(prov, OSSL_OP_KEYMGMT, algs, sizeof(algs)/sizeof(algs[0]));
+    printf("%-36s %14s %14s %14s %14s %12s %12s\n", "algorithm", "keygen/s",
+           "pubimport/s", "classical us", "full us", "bytes/key", "allocs/key");
+    for (i = 0; i < nalgs; i++) {
+        keygen_arg arg = { algs[i], NULL, 0, NULL };
+        bench_result gen, imp;
+        double bytes, blocks, classical_us, full_us;
+
+        if (!bench_alg_selected(algs[i], filter))
+            continue;
+        if (!get_public_key(&arg)
+            || !bench_run(bench_keygen, &arg, seconds, &gen)
+            || !bench_run(bench_import_public, &arg, seconds, &imp)
+            || !bench_validation(&arg, seconds, &classical_us, &full_us)
+            || !key_footprint(&arg, &bytes, &blocks)) {
+            fprintf(stderr, cRED "  Benchmark failed: %s" cNORM "\n", algs[i]);
+            ERR_print_errors_fp(stderr);
+            errcnt++;
+        } else {
+            printf("%-36s %14.1f %14.1f %14.1f %14.1f %12.0f %12.1f\n", algs[i],
+                   gen.ops_per_sec, imp.ops_per_sec, classical_us, full_us, bytes, blocks);
+        }
+        OPENSSL_free(arg.pub);
+    }
+
+    OSSL_PROVIDER_unload(prov);
+    OSSL_LIB_CTX_free(libctx);
+    return errcnt != 0;
+}
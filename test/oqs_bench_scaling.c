@@ -0,0 +1,297 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * Thread scaling benchmark: runs signing and verification with every
+ * signature algorithm, and encapsulation and decapsulation with every KEM,
+ * on 1, 2, 4, ... up to maxthreads threads sharing one library context and
+ * one key (a fresh EVP context per operation), and reports the aggregate
+ * ops/sec and the scaling efficiency relative to a single thread.
+ *
+ * To attribute what does not scale, it also reports
+ *  - CPU utilization: process CPU time over threads * wall time. Threads
+ *    sleeping on a contended lock (e.g. the secure heap lock or a property
+ *    cache lock taken by EVP_MD_fetch()) lower it; spinning or cache line
+ *    bouncing (e.g. key reference counts) rather raise CPU us/op.
+ *  - allocations per operation and the share of the threads' time spent
+ *    in the allocator, as counted by OPENSSL_malloc() hooks.
+ * With a secureheap size given, key material allocated with
+ * OPENSSL_secure_zalloc() comes from OpenSSL's secure heap, which has one
+ * global lock, instead of the (hooked) regular heap; comparing runs with
+ * and without shows its contribution.
+ *
+ * Usage: oqs_bench_scaling <modulename> <configfile> [algfilter] [seconds]
+ *                          [maxthreads] [secureheap]
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <openssl/core_dispatch.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/provider.h>
+#include "bench_common.h"
+#include "test_common.h"
+
+#define MAXTHREADS 256
+#define MSGLEN 64
+
+static OSSL_LIB_CTX *libctx = NULL;
+
+enum { OP_SIGN, OP_VERIFY, OP_ENCAPS, OP_DECAPS };
+static const char *op_names[] = { "sign", "verify", "encaps", "decaps" };
+
+/* shared by all threads */
+typedef struct {
+    int op;
+    EVP_PKEY *key;
+    unsigned char msg[MSGLEN];
+    unsigned char *sig, *ct;
+    size_t siglen, maxsiglen, ctlen, secretlen;
+    uint64_t budget_ns;
+    pthread_barrier_t barrier;
+} scale_arg;
+
+typedef struct {
+    scale_arg *arg;
+    unsigned char *buf, *buf2;
+    size_t ops, allocs;
+    uint64_t alloc_ns;
+    int ok;
+} scale_thread;
+
+static int run_op(scale_arg *arg, unsigned char *buf, unsigned char *buf2)
+{
+    EVP_MD_CTX *mdctx = NULL;
+    EVP_PKEY_CTX *ctx = NULL;
+    size_t len = arg->maxsiglen, len2 = arg->secretlen;
+    int ret = 0;
+
+    switch (arg->op) {
+    case OP_SIGN:
+        ret = (mdctx = EVP_MD_CTX_new()) != NULL
+              && EVP_DigestSignInit_ex(mdctx, NULL, NULL, libctx, NULL, arg->key, NULL) > 0
+              && EVP_DigestSign(mdctx, buf, &len, arg->msg, MSGLEN) > 0;
+        break;
+    case OP_VERIFY:
+        ret = (mdctx = EVP_MD_CTX_new()) != NULL
+              && EVP_DigestVerifyInit_ex(mdctx, NULL, NULL, libctx, NULL, arg->key, NULL) > 0
+              && EVP_DigestVerify(mdctx, arg->sig, arg->siglen, arg->msg, MSGLEN) > 0;
+        break;
+    case OP_ENCAPS:
+        len = arg->ctlen;
+        ret = (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, arg->key, NULL)) != NULL
+              && EVP_PKEY_encapsulate_init(ctx, NULL) > 0
+              && EVP_PKEY_encapsulate(ctx, buf, &len, buf2, &len2) > 0;
+        break;
+    case OP_DECAPS:
+        ret = (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, arg->key, NULL)) != NULL
+              && EVP_PKEY_decapsulate_init(ctx, NULL) > 0
+              && EVP_PKEY_decapsulate(ctx, buf2, &len2, arg->ct, arg->ctlen) > 0;
+        break;
+    }
+    EVP_MD_CTX_free(mdctx);
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+static void *scale_thread_main(void *vthread)
+{
+    scale_thread *thread = vthread;
+    scale_arg *arg = thread->arg;
+    uint64_t start;
+
+    pthread_barrier_wait(&arg->barrier);
+    bench_thread_allocs_reset();
+    start = bench_now_ns();
+    do {
+        if (!run_op(arg, thread->buf, thread->buf2)) {
+            thread->ok = 0;
+            break;
+        }
+        thread->ops++;
+    } while (bench_now_ns() - start < arg->budget_ns);
+    bench_thread_allocs(&thread->allocs, &thread->alloc_ns);
+    return NULL;
+}
+
+static uint64_t cpu_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* runs the operation on nthreads threads and prints a result line */
+static int run_threads(const char *alg, scale_arg *arg, int nthreads, double *base)
+{
+    scale_thread threads[MAXTHREADS];
+    pthread_t tids[MAXTHREADS];
+    size_t bufsize = arg->maxsiglen > arg->ctlen ? arg->maxsiglen : arg->ctlen;
+    size_t ops = 0, allocs = 0;
+    uint64_t alloc_ns = 0, start, cpu_start, wall_ns, cpu_ns;
+    double per_sec;
+    int i, started, ok = 1;
+
+    if (pthread_barrier_init(&arg->barrier, NULL, nthreads + 1) != 0)
+        return 0;
+    memset(threads, 0, sizeof(threads));
+    for (started = 0; started < nthreads; started++) {
+        threads[started].arg = arg;
+        threads[started].ok = 1;
+        if ((threads[started].buf = OPENSSL_malloc(bufsize)) == NULL
+            || (threads[started].buf2 = OPENSSL_malloc(arg->secretlen + 1)) == NULL
+            || pthread_create(&tids[started], NULL, scale_thread_main, &threads[started]) != 0)
+            break;
+    }
+    if (started < nthreads) {
+        // cannot release the barrier: give up on the whole process
+        fprintf(stderr, cRED "  Cannot start %d threads" cNORM "\n", nthreads);
+        exit(1);
+    }
+    pthread_barrier_wait(&arg->barrier);
+    start = bench_now_ns();
+    cpu_start = cpu_now_ns();
+    for (i = 0; i < nthreads; i++) {
+        pthread_join(tids[i], NULL);
+        ok = ok && threads[i].ok;
+        ops += threads[i].ops;
+        allocs += threads[i].allocs;
+        alloc_ns += threads[i].alloc_ns;
+        OPENSSL_free(threads[i].buf);
+        OPENSSL_free(threads[i].buf2);
+    }
+    wall_ns = bench_now_ns() - start;
+    cpu_ns = cpu_now_ns() - cpu_start;
+    pthread_barrier_destroy(&arg->barrier);
+    if (!ok || ops == 0)
+        return 0;
+
+    per_sec = (double)ops / ((double)wall_ns / 1e9);
+    if (nthreads == 1)
+        *base = per_sec;
+    printf("%-28s %-7s %7d %12.1f %10.2f %8.1f %10.1f %10.1f %8.1f\n", alg,
+           op_names[arg->op], nthreads, per_sec, per_sec / (nthreads * *base),
+           100.0 * cpu_ns / ((double)nthreads * wall_ns), cpu_ns / 1e3 / ops,
+           (double)allocs / ops, 100.0 * alloc_ns / ((double)nthreads * wall_ns));
+    return 1;
+}
+
+static int setup(const char *alg, int kem, scale_arg *arg)
+{
+    EVP_PKEY_CTX *ctx;
+    EVP_MD_CTX *mdctx = NULL;
+    unsigned char *secret = NULL;
+    int ret;
+
+    ret = (ctx = EVP_PKEY_CTX_new_from_name(libctx, alg, NULL)) != NULL
+          && EVP_PKEY_keygen_init(ctx) > 0
+          && EVP_PKEY_generate(ctx, &arg->key) > 0;
+    EVP_PKEY_CTX_free(ctx);
+    ctx = NULL;
+    if (kem) {
+        ret = ret
+              && (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, arg->key, NULL)) != NULL
+              && EVP_PKEY_encapsulate_init(ctx, NULL) > 0
+              && EVP_PKEY_encapsulate(ctx, NULL, &arg->ctlen, NULL, &arg->secretlen) > 0
+              && (arg->ct = OPENSSL_malloc(arg->ctlen)) != NULL
+              && (secret = OPENSSL_malloc(arg->secretlen)) != NULL
+              && EVP_PKEY_encapsulate(ctx, arg->ct, &arg->ctlen, secret, &arg->secretlen) > 0;
+        EVP_PKEY_CTX_free(ctx);
+        OPENSSL_free(secret);
+    } else {
+        arg->siglen = arg->maxsiglen = ret ? EVP_PKEY_get_size(arg->key) : 0;
+        ret = ret
+              && (arg->sig = OPENSSL_malloc(arg->maxsiglen)) != NULL
+              && (mdctx = EVP_MD_CTX_new()) != NULL
+              && EVP_DigestSignInit_ex(mdctx, NULL, NULL, libctx, NULL, arg->key, NULL) > 0
+              && EVP_DigestSign(mdctx, arg->sig, &arg->siglen, arg->msg, MSGLEN) > 0;
+        EVP_MD_CTX_free(mdctx);
+    }
+    return ret;
+}
+
+/* powers of 2, then maxthreads */
+static int next_nthreads(int nthreads, int maxthreads)
+{
+    return nthreads < maxthreads && 2 * nthreads > maxthreads ? maxthreads : 2 * nthreads;
+}
+
+static int bench_alg(const char *alg, int kem, double seconds, int maxthreads)
+{
+    scale_arg arg;
+    double base = 0;
+    int op, nthreads, ret;
+
+    memset(&arg, 0, sizeof(arg));
+    memset(arg.msg, 0x5a, MSGLEN);
+    arg.budget_ns = (uint64_t)(seconds * 1e9);
+    ret = setup(alg, kem, &arg);
+    for (op = kem ? OP_ENCAPS : OP_SIGN; ret && op <= (kem ? OP_DECAPS : OP_VERIFY); op++) {
+        arg.op = op;
+        for (nthreads = 1; ret && nthreads <= maxthreads;
+             nthreads = next_nthreads(nthreads, maxthreads))
+            ret = run_threads(alg, &arg, nthreads, &base);
+    }
+    EVP_PKEY_free(arg.key);
+    OPENSSL_free(arg.sig);
+    OPENSSL_free(arg.ct);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    OSSL_PROVIDER *prov;
+    const char *sigs[256], *kems[256], *filter = NULL;
+    double seconds = 0.5;
+    long maxthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t i, nsigs, nkems, secureheap = 0;
+    int errcnt = 0;
+
+    // before anything gets allocated
+    T(bench_count_allocs(1));
+    T(argc >= 3);
+    if (argc > 3)
+        filter = argv[3];
+    if (argc > 4)
+        seconds = atof(argv[4]);
+    if (argc > 5)
+        maxthreads = atol(argv[5]);
+    if (argc > 6)
+        secureheap = strtoul(argv[6], NULL, 0);
+    if (maxthreads < 1)
+        maxthreads = 1;
+    T(maxthreads <= MAXTHREADS);
+    if (secureheap > 0)
+        T(CRYPTO_secure_malloc_init(secureheap, 16) == 1);
+    T((libctx = OSSL_LIB_CTX_new()) != NULL);
+    T(OSSL_LIB_CTX_load_config(libctx, argv[2]));
+    T((prov = OSSL_PROVIDER_load(libctx, argv[1])) != NULL);
+
+    nsigs = bench_provider_algs(prov, OSSL_OP_SIGNATURE, sigs, sizeof(sigs)/sizeof(sigs[0]));
+    nkems = bench_provider_algs(prov, OSSL_OP_KEM, kems, sizeof(kems)/sizeof(kems[0]));
+    printf("# secure heap: %zu bytes\n", secureheap);
+    printf("%-28s %-7s %7s %12s %10s %8s %10s %10s %8s\n", "algorithm", "op",
+           "threads", "ops/s", "efficiency", "cpu %", "cpu us/op", "allocs/op",
+           "alloc %");
+    for (i = 0; i < nsigs + nkems; i++) {
+        const char *alg = i < nsigs ? sigs[i] : kems[i - nsigs];
+
+        if (!bench_alg_selected(alg, filter))
+            continue;
+        if (!bench_alg(alg, i >= nsigs, seconds, (int)maxthreads)) {
+            fprintf(stderr, cRED "  Benchmark failed: %s" cNORM "\n", alg);
+            ERR_print_errors_fp(stderr);
+            errcnt++;
+        }
+    }
+
+    OSSL_PROVIDER_unload(prov);
+    OSSL_LIB_CTX_free(libctx);
+    if (secureheap > 0)
+        CRYPTO_secure_malloc_done();
+    return errcnt != 0;
+}
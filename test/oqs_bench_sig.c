@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * Signature benchmark: for every plain and hybrid signature algorithm
+ * offered by the provider, measures ops/sec and p50/p99 latency of key
+ * generation, and of signing and verifying messages of several sizes with
+ * EVP_DigestSign()/EVP_DigestVerify() and the algorithm's default digest,
+ * as done for certificates and in TLS. Every operation uses a fresh
+ * context, so provider overhead is included.
+ *
+ * Results are written to stdout as JSON, one object per algorithm,
+ * operation and message size, to be compared across releases or with
+ * liboqs' own speed_sig. With a config file enabling the verify cache,
+ * verification of the same message is served from the cache.
+ *
+ * Usage: oqs_bench_sig <modulename> <configfile> [algfilter] [seconds]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/core_dispatch.h>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#include <openssl/provider.h>
+#include <openssl/rand.h>
+#include "bench_common.h"
+#include "test_common.h"
+
+static OSSL_LIB_CTX *libctx = NULL;
+
+static const size_t msglens[] = { 32, 1024, 65536 };
+#define NMSGLENS (sizeof(msglens)/sizeof(msglens[0]))
+#define MAXMSGLEN 65536
+
+typedef struct {
+    const char *alg;
+    EVP_PKEY *key;
+    unsigned char *msg;
+    size_t msglen;
+    unsigned char *sig;
+    size_t siglen, maxsiglen;
+} sig_arg;
+
+static int bench_keygen(void *varg)
+{
+    sig_arg *arg = varg;
+    EVP_PKEY_CTX *ctx;
+    EVP_PKEY *key = NULL;
+    int ret;
+
+    ret = (ctx = EVP_PKEY_CTX_new_from_name(libctx, arg->alg, NULL)) != NULL
+          && EVP_PKEY_keygen_init(ctx) > 0
+          && EVP_PKEY_generate(ctx, &key) > 0;
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+static int bench_sign(void *varg)
+{
+    sig_arg *arg = varg;
+    EVP_MD_CTX *mdctx;
+    int ret;
+
+    arg->siglen = arg->maxsiglen;
+    ret = (mdctx = EVP_MD_CTX_new()) != NULL
+          && EVP_DigestSignInit_ex(mdctx, NULL, NULL, libctx, NULL, arg->key, NULL) > 0
+          && EVP_DigestSign(mdctx, arg->sig, &arg->siglen, arg->msg, arg->msglen) > 0;
+    EVP_MD_CTX_free(mdctx);
+    return ret;
+}
+
+static int bench_verify(void *varg)
+{
+    sig_arg *arg = varg;
+    EVP_MD_CTX *mdctx;
+    int ret;
+
+    ret = (mdctx = EVP_MD_CTX_new()) != NULL
+          && EVP_DigestVerifyInit_ex(mdctx, NULL, NULL, libctx, NULL, arg->key, NULL) > 0
+          && EVP_DigestVerify(mdctx, arg->sig, arg->siglen, arg->msg, arg->msglen) > 0;
+    EVP_MD_CTX_free(mdctx);
+    return ret;
+}
+
+static int setup(sig_arg *arg)
+{
+    EVP_PKEY_CTX *ctx;
+    int ret;
+
+    ret = (ctx = EVP_PKEY_CTX_new_from_name(libctx, arg->alg, NULL)) != NULL
+          && EVP_PKEY_keygen_init(ctx) > 0
+          && EVP_PKEY_generate(ctx, &arg->key) > 0
+          && (arg->maxsiglen = EVP_PKEY_get_size(arg->key)) > 0
+          && (arg->sig = OPENSSL_malloc(arg->maxsiglen)) != NULL;
+    EVP_PKEY_CTX_free(ctx);
+    return ret;
+}
+
+static void print_result(int *first, const char *alg, const char *op,
+                         size_t msglen, const bench_result *res)
+{
+    printf("%s\n    {\"algorithm\": \"%s\", \"operation\": \"%s\", \"msglen\": %zu, "
+           "\"iterations\": %zu, \"ops_per_sec\": %.1f, \"p50_us\": %.1f, "
+           "\"p99_us\": %.1f}", *first ? "" : ",", alg, op, msglen,
+           res->iterations, res->ops_per_sec, res->p50_us, res->p99_us);
+    *first = 0;
+}
+
+int main(int argc, char *argv[])
+{
+    OSSL_PROVIDER *prov;
+    const char *algs[256], *filter = NULL;
+    const char *version = "", *buildinfo = "";
+    OSSL_PARAM params[3];
+    unsigned char *msg;
+    double seconds = 0.2;
+    size_t i, m, nalgs;
+    int errcnt = 0, first = 1;
+
+    T((libctx = OSSL_LIB_CTX_new()) != NULL);
+    T(argc >= 3);
+    T(OSSL_LIB_CTX_load_config(libctx, argv[2]));
+    T((prov = OSSL_PROVIDER_load(libctx, argv[1])) != NULL);
+    if (argc > 3)
+        filter = argv[3];
+    if (argc > 4)
+        seconds = atof(argv[4]);
+    T((msg = OPENSSL_malloc(MAXMSGLEN)) != NULL);
+    T(RAND_bytes_ex(libctx, msg, MAXMSGLEN, 0) > 0);
+
+    params[0] = OSSL_PARAM_construct_utf8_ptr(OSSL_PROV_PARAM_VERSION,
+                                              (char **)&version, 0);
+    params[1] = OSSL_PARAM_construct_utf8_ptr(OSSL_PROV_PARAM_BUILDINFO,
+                                              (char **)&buildinfo, 0);
+    params[2] = OSSL_PARAM_construct_end();
+    T(OSSL_PROVIDER_get_params(prov, params));
+
+    nalgs = bench_provider_algs(prov, OSSL_OP_SIGNATURE, algs, sizeof(algs)/sizeof(algs[0]));
+    printf("{\n  \"benchmark\": \"oqs_bench_sig\",\n  \"version\": \"%s\",\n"
+           "  \"buildinfo\": \"%s\",\n  \"seconds\": %.3f,\n  \"results\": [",
+           version, buildinfo, seconds);
+    for (i = 0; i < nalgs; i++) {
+        sig_arg arg;
+        bench_result res;
+
+        if (!bench_alg_selected(algs[i], filter))
+            continue;
+        memset(&arg, 0, sizeof(arg));
+        arg.alg = algs[i];
+        arg.msg = msg;
+        if (!setup(&arg)) {
+            fprintf(stderr, cRED "  Benchmark setup failed: %s" cNORM "\n", algs[i]);
+            ERR_print_errors_fp(stderr);
+            errcnt++;
+            goto next;
+        }
+        if (!bench_run(bench_keygen, &arg, seconds, &res)) {
+            fprintf(stderr, cRED "  Benchmark failed: %s (keygen)" cNORM "\n", algs[i]);
+            ERR_print_errors_fp(stderr);
+            errcnt++;
+            goto next;
+        }
+        print_result(&first, algs[i], "keygen", 0, &res);
+        for (m = 0; m < NMSGLENS; m++) {
+            arg.msglen = msglens[m];
+            if (!bench_run(bench_sign, &arg, seconds, &res)) {
+                fprintf(stderr, cRED "  Benchmark failed: %s (sign %zu)" cNORM "\n",
+                        algs[i], msglens[m]);
+                ERR_print_errors_fp(stderr);
+                errcnt++;
+                break;
+            }
+            print_result(&first, algs[i], "sign", msglens[m], &res);
+            // verifies the signature of the last sign call
+            if (!bench_run(bench_verify, &arg, seconds, &res)) {
+                fprintf(stderr, cRED "  Benchmark failed: %s (verify %zu)" cNORM "\n",
+                        algs[i], msglens[m]);
+                ERR_print_errors_fp(stderr);
+                errcnt++;
+                break;
+            }
+            print_result(&first, algs[i], "verify", msglens[m], &res);
+        }
+ next:
+        EVP_PKEY_free(arg.key);
+        OPENSSL_free(arg.sig);
+    }
+    printf("\n  ]\n}\n");
+
+    OPENSSL_free(msg);
+    OSSL_PROVIDER_unload(prov);
+    OSSL_LIB_CTX_free(libctx);
+    return errcnt != 0;
+}
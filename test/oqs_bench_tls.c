@@ -0,0 +1,233 @@
+// SPDX-License-Identifier: Apache-2.0 AND MIT
+
+/*
+ * TLS 1.3 handshake benchmark: measures full handshakes/sec, and CPU time
+ * per handshake, between an in-memory client and server (as set up by
+ * oqs_test_groups and oqs_test_tlssig) for every TLS group and every TLS
+ * signature algorithm the provider announces. Groups are run with the
+ * classical test server certificate, signature algorithms with their
+ * <sigalg>_srv.crt/.key from the directory also used by oqs_test_tlssig
+ * and the default groups. CPU time covers both client and server.
+ *
+ * With threads > 1, that many threads run handshakes concurrently (each
+ * with its own SSL objects, sharing the SSL_CTXs) and the throughput of
+ * all of them is reported.
+ *
+ * Usage: oqs_bench_tls <modulename> <configfile> <certsdir> <sigcertsdir>
+ *                      [algfilter] [seconds] [threads]
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/core_names.h>
+#include <openssl/provider.h>
+#include <openssl/ssl.h>
+#include "helpers/ssltestlib.h"
+#include "bench_common.h"
+#include "test_common.h"
+
+#define MAXALGS 256
+#define MAXTHREADS 64
+
+static OSSL_LIB_CTX *libctx = NULL;
+
+typedef struct {
+    char *names[MAXALGS];
+    size_t n;
+    const char *key;
+} alg_list;
+
+typedef struct {
+    SSL_CTX *sctx, *cctx;
+    const char *group;  /* NULL for the default groups */
+    uint64_t budget_ns;
+    size_t handshakes;
+    int ok;
+} tls_arg;
+
+static int handshake(tls_arg *arg)
+{
+    SSL *clientssl = NULL, *serverssl = NULL;
+    int ret;
+
+    ret = create_ssl_objects(arg->sctx, arg->cctx, &serverssl, &clientssl, NULL, NULL)
+          && (arg->group == NULL
+              || (SSL_set1_groups_list(serverssl, arg->group)
+                  && SSL_set1_groups_list(clientssl, arg->group)))
+          && create_ssl_connection(serverssl, clientssl, SSL_ERROR_NONE);
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    return ret;
+}
+
+static void *bench_thread(void *varg)
+{
+    tls_arg *arg = varg;
+    uint64_t start = bench_now_ns();
+
+    do {
+        if (!handshake(arg)) {
+            arg->ok = 0;
+            break;
+        }
+        arg->handshakes++;
+    } while (bench_now_ns() - start < arg->budget_ns);
+    return NULL;
+}
+
+static uint64_t cpu_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* runs handshakes on nthreads threads for the given time */
+static int bench_handshakes(SSL_CTX *sctx, SSL_CTX *cctx, const char *group,
+                            int nthreads, double seconds,
+                            double *per_sec, double *cpu_us)
+{
+    tls_arg args[MAXTHREADS];
+    pthread_t threads[MAXTHREADS];
+    uint64_t start, cpu_start;
+    size_t total = 0;
+    int i, started, ok = 1;
+
+    // warm up, e.g. certificate and key caches
+    args[0].sctx = sctx;
+    args[0].cctx = cctx;
+    args[0].group = group;
+    if (!handshake(&args[0]))
+        return 0;
+
+    start = bench_now_ns();
+    cpu_start = cpu_now_ns();
+    for (started = 0; started < nthreads; started++) {
+        args[started].sctx = sctx;
+        args[started].cctx = cctx;
+        args[started].group = group;
+        args[started].budget_ns = (uint64_t)(seconds * 1e9);
+        args[started].handshakes = 0;
+        args[started].ok = 1;
+        if (pthread_create(&threads[started], NULL, bench_thread, &args[started]) != 0) {
+            ok = 0;
+            break;
+        }
+    }
+    for (i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        ok = ok && args[i].ok;
+        total += args[i].handshakes;
+    }
+    if (ok && total > 0) {
+        *per_sec = (double)total / ((double)(bench_now_ns() - start) / 1e9);
+        *cpu_us = (double)(cpu_now_ns() - cpu_start) / 1e3 / (double)total;
+    }
+    return ok && total > 0;
+}
+
+static int collect_alg(const OSSL_PARAM params[], void *data)
+{
+    alg_list *list = data;
+    const OSSL_PARAM *p = OSSL_PARAM_locate_const(params, list->key);
+
+    if (p == NULL || p->data_type != OSSL_PARAM_UTF8_STRING)
+        return 0;
+    if (list->n < MAXALGS
+        && (list->names[list->n] = OPENSSL_strdup(p->data)) != NULL)
+        list->n++;
+    return 1;
+}
+
+static void report(const char *alg, const char *type, int ok, double per_sec,
+                   double cpu_us, int *errcnt)
+{
+    if (ok) {
+        printf("%-40s %-7s %14.1f %14.1f\n", alg, type, per_sec, cpu_us);
+    } else {
+        fprintf(stderr, cRED "  Benchmark failed: %s (%s)" cNORM "\n", alg, type);
+        ERR_print_errors_fp(stderr);
+        (*errcnt)++;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    OSSL_PROVIDER *prov;
+    alg_list groups = { { NULL }, 0, OSSL_CAPABILITY_TLS_GROUP_NAME };
+#ifdef OSSL_CAPABILITY_TLS_SIGALG_NAME
+    alg_list sigalgs = { { NULL }, 0, OSSL_CAPABILITY_TLS_SIGALG_NAME };
+#else
+    alg_list sigalgs = { { NULL }, 0, NULL };
+#endif
+    const char *filter = NULL;
+    char certpath[300], keypath[300];
+    double seconds = 0.5, per_sec = 0, cpu_us = 0;
+    SSL_CTX *sctx, *cctx;
+    size_t i;
+    int errcnt = 0, nthreads = 1, ok;
+
+    T((libctx = OSSL_LIB_CTX_new()) != NULL);
+    T(argc >= 5);
+    T(OSSL_LIB_CTX_load_config(libctx, argv[2]));
+    T((prov = OSSL_PROVIDER_load(libctx, argv[1])) != NULL);
+    T(OSSL_PROVIDER_available(libctx, "default"));
+    if (argc > 5)
+        filter = argv[5];
+    if (argc > 6)
+        seconds = atof(argv[6]);
+    if (argc > 7)
+        nthreads = atoi(argv[7]);
+    T(nthreads > 0 && nthreads <= MAXTHREADS);
+
+    T(OSSL_PROVIDER_get_capabilities(prov, "TLS-GROUP", collect_alg, &groups));
+#ifdef OSSL_CAPABILITY_TLS_SIGALG_NAME
+    T(OSSL_PROVIDER_get_capabilities(prov, "TLS-SIGALG", collect_alg, &sigalgs));
+#else
+    fprintf(stderr, "TLS-SIG handshakes not supported by this OpenSSL version.\n");
+#endif
+
+    printf("%-40s %-7s %14s %14s   (%d thread%s)\n", "algorithm", "type",
+           "handshakes/s", "cpu us/hs", nthreads, nthreads > 1 ? "s" : "");
+    snprintf(certpath, sizeof(certpath), "%s/servercert.pem", argv[3]);
+    snprintf(keypath, sizeof(keypath), "%s/serverkey.pem", argv[3]);
+    for (i = 0; i < groups.n; i++) {
+        if (!bench_alg_selected(groups.names[i], filter))
+            continue;
+        sctx = cctx = NULL;
+        ok = create_ssl_ctx_pair(libctx, TLS_server_method(), TLS_client_method(),
+                                 TLS1_3_VERSION, TLS1_3_VERSION,
+                                 &sctx, &cctx, certpath, keypath)
+             && bench_handshakes(sctx, cctx, groups.names[i], nthreads, seconds,
+                                 &per_sec, &cpu_us);
+        report(groups.names[i], "group", ok, per_sec, cpu_us, &errcnt);
+        SSL_CTX_free(sctx);
+        SSL_CTX_free(cctx);
+    }
+    for (i = 0; i < sigalgs.n; i++) {
+        if (!bench_alg_selected(sigalgs.names[i], filter))
+            continue;
+        snprintf(certpath, sizeof(certpath), "%s/%s_srv.crt", argv[4], sigalgs.names[i]);
+        snprintf(keypath, sizeof(keypath), "%s/%s_srv.key", argv[4], sigalgs.names[i]);
+        sctx = cctx = NULL;
+        ok = create_ssl_ctx_pair(libctx, TLS_server_method(), TLS_client_method(),
+                                 TLS1_3_VERSION, TLS1_3_VERSION,
+                                 &sctx, &cctx, certpath, keypath)
+             && bench_handshakes(sctx, cctx, NULL, nthreads, seconds,
+                                 &per_sec, &cpu_us);
+        report(sigalgs.names[i], "sigalg", ok, per_sec, cpu_us, &errcnt);
+        SSL_CTX_free(sctx);
+        SSL_CTX_free(cctx);
+    }
+
+    for (i = 0; i < groups.n; i++)
+        OPENSSL_free(groups.names[i]);
+    for (i = 0; i < sigalgs.n; i++)
+        OPENSSL_free(sigalgs.names[i]);
+    OSSL_PROVIDER_unload(prov);
+    OSSL_LIB_CTX_free(libctx);
+    return errcnt != 0;
+}
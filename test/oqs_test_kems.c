@@ -1,14 +1,18 @@
 // SPDX-License-Identifier: Apache-2.0 AND MIT
 
+#include <openssl/core_names.h>
 #include <openssl/evp.h>
 #include <openssl/provider.h>
 #include "test_common.h"
 #include <string.h>
+#include <unistd.h>
 #include "oqs/oqs.h"
 
 static OSSL_LIB_CTX *libctx = NULL;
 static char *modulename = NULL;
 static char *configfile = NULL;
+/* set by the "pools" argument: the configuration has pools for the tested algorithms */
+static int expect_pools = 0;
 
 #define ECP_NAME(secbits, oqsname) \
     (secbits == 128 ? "p256_" #oqsname "" : \
@@ -135,6 +139,362 @@ err:
   return testresult;
 }
 
+// keys imported from raw key material must decapsulate repeatedly
+static int test_oqs_kems_imported(const char *kemalg_name)
+{
+  EVP_PKEY_CTX *ctx = NULL;
+  EVP_PKEY *key = NULL, *key2 = NULL;
+  OSSL_PARAM params[3];
+  unsigned char *priv = NULL, *pub = NULL;
+  unsigned char *out = NULL, *secenc = NULL, *secdec = NULL;
+  size_t privlen, publen, outlen, seclen, i;
+
+  int testresult = 1;
+
+  if (!alg_is_enabled(kemalg_name) || !OSSL_PROVIDER_available(libctx, "default"))
+     return 1;
+
+  testresult &=
+    (ctx = EVP_PKEY_CTX_new_from_name(libctx, kemalg_name, NULL)) != NULL
+    && EVP_PKEY_keygen_init(ctx)
+    && EVP_PKEY_generate(ctx, &key)
+    && EVP_PKEY_get_octet_string_param(key, OSSL_PKEY_PARAM_PRIV_KEY, NULL, 0, &privlen)
+    && (priv = OPENSSL_malloc(privlen)) != NULL
+    && EVP_PKEY_get_octet_string_param(key, OSSL_PKEY_PARAM_PRIV_KEY, priv, privlen, &privlen)
+    && EVP_PKEY_get_octet_string_param(key, OSSL_PKEY_PARAM_PUB_KEY, NULL, 0, &publen)
+    && (pub = OPENSSL_malloc(publen)) != NULL
+    && EVP_PKEY_get_octet_string_param(key, OSSL_PKEY_PARAM_PUB_KEY, pub, publen, &publen);
+  if (!testresult) goto err;
+  EVP_PKEY_CTX_free(ctx);
+
+  params[0] = OSSL_PARAM_construct_octet_string(OSSL_PKEY_PARAM_PRIV_KEY, priv, privlen);
+  params[1] = OSSL_PARAM_construct_octet_string(OSSL_PKEY_PARAM_PUB_KEY, pub, publen);
+  params[2] = OSSL_PARAM_construct_end();
+  testresult &=
+    (ctx = EVP_PKEY_CTX_new_from_name(libctx, kemalg_name, NULL)) != NULL
+    && EVP_PKEY_fromdata_init(ctx)
+    && EVP_PKEY_fromdata(ctx, &key2, EVP_PKEY_KEYPAIR, params);
+  if (!testresult) goto err;
+  EVP_PKEY_CTX_free(ctx);
+
+  testresult &=
+    (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, key2, NULL)) != NULL
+    && EVP_PKEY_encapsulate_init(ctx, NULL)
+    && EVP_PKEY_encapsulate(ctx, NULL, &outlen, NULL, &seclen)
+    && (out = OPENSSL_malloc(outlen)) != NULL
+    && (secenc = OPENSSL_malloc(seclen)) != NULL
+    && (secdec = OPENSSL_malloc(seclen)) != NULL
+    && EVP_PKEY_decapsulate_init(ctx, NULL);
+  for (i = 0; testresult && i < 2; i++)
+    testresult &=
+      EVP_PKEY_encapsulate_init(ctx, NULL)
+      && EVP_PKEY_encapsulate(ctx, out, &outlen, secenc, &seclen)
+      && EVP_PKEY_decapsulate_init(ctx, NULL)
+      && EVP_PKEY_decapsulate(ctx, secdec, &seclen, out, outlen)
+      && EVP_PKEY_decapsulate(ctx, secdec, &seclen, out, outlen)
+      && memcmp(secenc, secdec, seclen) == 0;
+
+err:
+  EVP_PKEY_free(key);
+  EVP_PKEY_free(key2);
+  EVP_PKEY_CTX_free(ctx);
+  OPENSSL_free(priv);
+  OPENSSL_free(pub);
+  OPENSSL_free(out);
+  OPENSSL_free(secenc);
+  OPENSSL_free(secdec);
+  return testresult;
+}
+
+// encapsulations with classical and PQ halves run concurrently must be
+// interchangeable with those done serially
+static int test_oqs_kems_parallel(const char *kemalg_name)
+{
+  EVP_PKEY_CTX *ctx = NULL;
+  EVP_PKEY *key = NULL;
+  unsigned char *out = NULL, *secenc = NULL, *secdec = NULL;
+  int on = 1, off = 0;
+  OSSL_PARAM parallel[2] = {
+    OSSL_PARAM_int("hybrid-parallel", &on), OSSL_PARAM_END
+  };
+  OSSL_PARAM serial[2] = {
+    OSSL_PARAM_int("hybrid-parallel", &off), OSSL_PARAM_END
+  };
+  size_t outlen, seclen;
+
+  int testresult = 1;
+
+  if (!alg_is_enabled(kemalg_name) || !OSSL_PROVIDER_available(libctx, "default"))
+     return 1;
+
+  testresult &=
+    (ctx = EVP_PKEY_CTX_new_from_name(libctx, kemalg_name, NULL)) != NULL
+    && EVP_PKEY_keygen_init(ctx)
+    && EVP_PKEY_generate(ctx, &key);
+  if (!testresult) goto err;
+  EVP_PKEY_CTX_free(ctx);
+
+  testresult &=
+    (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, key, NULL)) != NULL
+    && EVP_PKEY_encapsulate_init(ctx, parallel)
+    && EVP_PKEY_encapsulate(ctx, NULL, &outlen, NULL, &seclen)
+    && (out = OPENSSL_malloc(outlen)) != NULL
+    && (secenc = OPENSSL_malloc(seclen)) != NULL
+    && (secdec = OPENSSL_malloc(seclen)) != NULL
+    && EVP_PKEY_encapsulate(ctx, out, &outlen, secenc, &seclen)
+    && EVP_PKEY_decapsulate_init(ctx, serial)
+    && EVP_PKEY_decapsulate(ctx, secdec, &seclen, out, outlen)
+    && memcmp(secenc, secdec, seclen) == 0
+    && EVP_PKEY_encapsulate_init(ctx, serial)
+    && EVP_PKEY_encapsulate(ctx, out, &outlen, secenc, &seclen)
+    && EVP_PKEY_decapsulate_init(ctx, parallel)
+    && EVP_PKEY_decapsulate(ctx, secdec, &seclen, out, outlen)
+    && memcmp(secenc, secdec, seclen) == 0;
+  if (!testresult) goto err;
+
+  // a broken PQ half must be noticed also when decapsulated on a worker thread
+  out[outlen - 1] = ~out[outlen - 1];
+  testresult &=
+    memset(secdec, 0xff, seclen) != NULL
+    && (EVP_PKEY_decapsulate(ctx, secdec, &seclen, out, outlen) || 1)
+    && memcmp(secenc, secdec, seclen) != 0;
+
+err:
+  EVP_PKEY_free(key);
+  EVP_PKEY_CTX_free(ctx);
+  OPENSSL_free(out);
+  OPENSSL_free(secenc);
+  OPENSSL_free(secdec);
+  return testresult;
+}
+
+static int encaps_and_decaps(EVP_PKEY *key)
+{
+  EVP_PKEY_CTX *ctx;
+  unsigned char *out = NULL, *secenc = NULL, *secdec = NULL;
+  size_t outlen, seclen;
+  int ret;
+
+  ret = (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, key, NULL)) != NULL
+    && EVP_PKEY_encapsulate_init(ctx, NULL)
+    && EVP_PKEY_encapsulate(ctx, NULL, &outlen, NULL, &seclen)
+    && (out = OPENSSL_malloc(outlen)) != NULL
+    && (secenc = OPENSSL_malloc(seclen)) != NULL
+    && (secdec = OPENSSL_malloc(seclen)) != NULL
+    && EVP_PKEY_encapsulate(ctx, out, &outlen, secenc, &seclen)
+    && EVP_PKEY_decapsulate_init(ctx, NULL)
+    && EVP_PKEY_decapsulate(ctx, secdec, &seclen, out, outlen)
+    && memcmp(secenc, secdec, seclen) == 0;
+  EVP_PKEY_CTX_free(ctx);
+  OPENSSL_free(out);
+  OPENSSL_free(secenc);
+  OPENSSL_free(secdec);
+  return ret;
+}
+
+// keys generated at every keygen-validation level, including the pairwise
+// encaps/decaps check of "full", must work
+static int test_oqs_kems_keygen_validation(const char *kemalg_name)
+{
+  static const char *levels[] = { "off", "classical", "full" };
+  EVP_PKEY_CTX *ctx = NULL;
+  EVP_PKEY *key = NULL;
+  OSSL_PARAM params[2];
+  size_t i;
+
+  int testresult = 1;
+
+  if (!alg_is_enabled(kemalg_name))
+     return 1;
+
+  testresult &=
+    (ctx = EVP_PKEY_CTX_new_from_name(libctx, kemalg_name, NULL)) != NULL
+    && EVP_PKEY_keygen_init(ctx);
+  for (i = 0; testresult && i < sizeof(levels)/sizeof(levels[0]); i++) {
+    params[0] = OSSL_PARAM_construct_utf8_string("keygen-validation",
+                                                 (char *)levels[i], 0);
+    params[1] = OSSL_PARAM_construct_end();
+    testresult &=
+      EVP_PKEY_CTX_set_params(ctx, params)
+      && EVP_PKEY_generate(ctx, &key)
+      && encaps_and_decaps(key);
+    EVP_PKEY_free(key);
+    key = NULL;
+  }
+  // unknown levels are rejected
+  params[0] = OSSL_PARAM_construct_utf8_string("keygen-validation", "some", 0);
+  testresult &= testresult && !EVP_PKEY_CTX_set_params(ctx, params);
+  ERR_clear_error();
+
+  EVP_PKEY_CTX_free(ctx);
+  return testresult;
+}
+
+static int get_pool_stats(OSSL_PROVIDER *prov, const char *hitsname,
+                          size_t *hits, const char *missesname, size_t *misses)
+{
+  OSSL_PARAM params[3];
+
+  params[0] = OSSL_PARAM_construct_size_t(hitsname, hits);
+  params[1] = OSSL_PARAM_construct_size_t(missesname, misses);
+  params[2] = OSSL_PARAM_construct_end();
+  return OSSL_PROVIDER_get_params(prov, params);
+}
+
+static int get_keypool_stats(OSSL_PROVIDER *prov, size_t *hits, size_t *misses)
+{
+  return get_pool_stats(prov, "keygen-pool-hits", hits, "keygen-pool-misses", misses);
+}
+
+// with a key pool configured for the algorithm, keys must eventually come
+// from the pool, and every pooled key must be handed out only once; with
+// expect_pools set, the pool must be configured
+static int test_oqs_kems_keypool(const char *kemalg_name)
+{
+  OSSL_PROVIDER *prov = NULL;
+  EVP_PKEY_CTX *ctx = NULL;
+  EVP_PKEY *key = NULL, *prev = NULL;
+  size_t hits0 = 0, misses0 = 0, hits = 0, misses = 0, i;
+  int pooled = 0;
+
+  int testresult = 1;
+
+  if (!alg_is_enabled(kemalg_name))
+     return 1;
+
+  testresult &=
+    (prov = OSSL_PROVIDER_load(libctx, modulename)) != NULL
+    && get_keypool_stats(prov, &hits0, &misses0)
+    && (ctx = EVP_PKEY_CTX_new_from_name(libctx, kemalg_name, NULL)) != NULL
+    && EVP_PKEY_keygen_init(ctx);
+  for (i = 0; testresult && i < 500 && pooled < 2; i++) {
+    EVP_PKEY_free(prev);
+    prev = key;
+    key = NULL;
+    testresult &=
+      EVP_PKEY_generate(ctx, &key)
+      && get_keypool_stats(prov, &hits, &misses);
+    if (!testresult)
+      break;
+    if (hits + misses == hits0 + misses0) {
+      // no pool configured for this algorithm
+      testresult &= !expect_pools;
+      break;
+    }
+    if (hits > hits0) {
+      hits0 = hits;
+      pooled++;
+      testresult &= prev == NULL || EVP_PKEY_eq(key, prev) != 1;
+    }
+    else
+      usleep(10000);
+  }
+  if (testresult && hits + misses != hits0 + misses0)
+    testresult &= pooled == 2;
+
+  EVP_PKEY_free(prev);
+  EVP_PKEY_free(key);
+  EVP_PKEY_CTX_free(ctx);
+  OSSL_PROVIDER_unload(prov);
+  return testresult;
+}
+
+// the length of the classical part of a hybrid KEM key's public key, and so
+// of its ciphertext, from the length header of the public key
+static int get_classical_pubkey_len(EVP_PKEY *key, size_t *len)
+{
+  unsigned char *pub = NULL;
+  size_t publen = 0;
+  int ret;
+
+  ret = EVP_PKEY_get_octet_string_param(key, OSSL_PKEY_PARAM_PUB_KEY, NULL, 0, &publen)
+        && publen > 4
+        && (pub = OPENSSL_malloc(publen)) != NULL
+        && EVP_PKEY_get_octet_string_param(key, OSSL_PKEY_PARAM_PUB_KEY, pub, publen, &publen);
+  if (ret) {
+    *len = (size_t)pub[0] << 24 | (size_t)pub[1] << 16 | (size_t)pub[2] << 8 | pub[3];
+    ret = *len > 0 && *len < publen - 4;
+  }
+  OPENSSL_free(pub);
+  return ret;
+}
+
+// with an ECDH pool configured, hybrid encapsulation must eventually use
+// pooled ephemeral keys, each of them only once, and still decapsulate;
+// with expect_pools set, the pool must be configured
+static int test_oqs_kems_ecdh_pool(const char *kemalg_name)
+{
+  OSSL_PROVIDER *prov = NULL;
+  EVP_PKEY_CTX *ctx = NULL;
+  EVP_PKEY *key = NULL;
+  unsigned char *out = NULL, *prev = NULL, *secenc = NULL, *secdec = NULL;
+  size_t outlen, seclen, classical_len = 0;
+  size_t hits0 = 0, misses0 = 0, hits = 0, misses = 0, i;
+  int pooled = 0;
+
+  int testresult = 1;
+
+  if (!alg_is_enabled(kemalg_name))
+     return 1;
+
+  testresult &=
+    (prov = OSSL_PROVIDER_load(libctx, modulename)) != NULL
+    && get_pool_stats(prov, "ecdh-pool-hits", &hits0, "ecdh-pool-misses", &misses0)
+    && (ctx = EVP_PKEY_CTX_new_from_name(libctx, kemalg_name, NULL)) != NULL
+    && EVP_PKEY_keygen_init(ctx)
+    && EVP_PKEY_generate(ctx, &key);
+  EVP_PKEY_CTX_free(ctx);
+  ctx = NULL;
+  testresult &=
+    testresult
+    && get_classical_pubkey_len(key, &classical_len)
+    && (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, key, NULL)) != NULL
+    && EVP_PKEY_encapsulate_init(ctx, NULL)
+    && EVP_PKEY_encapsulate(ctx, NULL, &outlen, NULL, &seclen)
+    && classical_len < outlen
+    && (out = OPENSSL_malloc(outlen)) != NULL
+    && (prev = OPENSSL_zalloc(classical_len)) != NULL
+    && (secenc = OPENSSL_malloc(seclen)) != NULL
+    && (secdec = OPENSSL_malloc(seclen)) != NULL;
+  for (i = 0; testresult && i < 500 && pooled < 2; i++) {
+    testresult &=
+      EVP_PKEY_encapsulate_init(ctx, NULL)
+      && EVP_PKEY_encapsulate(ctx, out, &outlen, secenc, &seclen)
+      && EVP_PKEY_decapsulate_init(ctx, NULL)
+      && EVP_PKEY_decapsulate(ctx, secdec, &seclen, out, outlen)
+      && memcmp(secenc, secdec, seclen) == 0
+      && get_pool_stats(prov, "ecdh-pool-hits", &hits, "ecdh-pool-misses", &misses);
+    if (!testresult)
+      break;
+    if (hits + misses == hits0 + misses0) {
+      // no ECDH pool configured
+      testresult &= !expect_pools;
+      break;
+    }
+    if (hits > hits0) {
+      hits0 = hits;
+      pooled++;
+      // the classical ephemeral public key comes first in the ciphertext;
+      // the PQ part differs anyway
+      testresult &= memcmp(out, prev, classical_len) != 0;
+      memcpy(prev, out, classical_len);
+    }
+    else
+      usleep(10000);
+  }
+  if (testresult && hits + misses != hits0 + misses0)
+    testresult &= pooled == 2;
+
+  EVP_PKEY_free(key);
+  EVP_PKEY_CTX_free(ctx);
+  OPENSSL_free(out);
+  OPENSSL_free(prev);
+  OPENSSL_free(secenc);
+  OPENSSL_free(secdec);
+  OSSL_PROVIDER_unload(prov);
+  return testresult;
+}
+
 #define nelem(a) (sizeof(a)/sizeof((a)[0]))
 
 int main(int argc, char *argv[])
@@ -143,16 +503,19 @@ int main(int argc, char *argv[])
   int errcnt = 0, test = 0;
 
   T((libctx = OSSL_LIB_CTX_new()) != NULL);
-  T(argc == 3);
+  T(argc == 3 || (argc == 4 && strcmp(argv[3], "pools") == 0));
   modulename = argv[1];
   configfile = argv[2];
+  expect_pools = argc == 4;
 
   T(OSSL_LIB_CTX_load_config(libctx, configfile));
 
   T(OSSL_PROVIDER_available(libctx, modulename));
 
   for (i = 0; i < nelem(kemalg_names); i++) {
-    if (test_oqs_kems(kemalg_names[i])) {
+    if (test_oqs_kems(kemalg_names[i])
+        && test_oqs_kems_imported(kemalg_names[i])
+        && test_oqs_kems_parallel(kemalg_names[i])) {
       fprintf(stderr,
               cGREEN "  KEM test succeeded: %s" cNORM "\n",
               kemalg_names[i]);
@@ -165,6 +528,26 @@ int main(int argc, char *argv[])
     }
   }
 
+  // one PQ KEM and one hybrid
+  for (i = 0; i < 2 && i < nelem(kemalg_names); i++) {
+    if (!test_oqs_kems_keygen_validation(kemalg_names[i])) {
+      fprintf(stderr, cRED "  KEM keygen validation test failed: %s" cNORM "\n",
+              kemalg_names[i]);
+      ERR_print_errors_fp(stderr);
+      errcnt++;
+    }
+  }
+  if (nelem(kemalg_names) > 0 && !test_oqs_kems_keypool(kemalg_names[0])) {
+    fprintf(stderr, cRED "  KEM key pool test failed" cNORM "\n");
+    ERR_print_errors_fp(stderr);
+    errcnt++;
+  }
+  if (nelem(kemalg_names) > 1 && !test_oqs_kems_ecdh_pool(kemalg_names[1])) {
+    fprintf(stderr, cRED "  KEM ECDH pool test failed" cNORM "\n");
+    ERR_print_errors_fp(stderr);
+    errcnt++;
+  }
+
   OSSL_LIB_CTX_free(libctx);
 
   TEST_ASSERT(errcnt == 0)
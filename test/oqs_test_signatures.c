@@ -1,9 +1,13 @@
 // SPDX-License-Identifier: Apache-2.0 AND MIT
 
 #include <openssl/evp.h>
+#include <openssl/params.h>
 #include <openssl/provider.h>
+#include <stdlib.h>
+#include <string.h>
 #include "test_common.h"
 #include "oqs/oqs.h"
+#include "oqs_batch.h"
 
 static OSSL_LIB_CTX *libctx = NULL;
 static char *modulename = NULL;
@@ -131,6 +135,551 @@ static int test_oqs_signatures(const char *sigalg_name)
   return testresult;
 }
 
+// data fed in many small updates must verify when passed in one go, and vice versa
+static int test_oqs_signatures_streaming(const char *sigalg_name)
+{
+  EVP_MD_CTX *mdctx = NULL;
+  EVP_PKEY_CTX *ctx = NULL;
+  EVP_PKEY *key = NULL;
+  unsigned char *msg = NULL, *sig = NULL;
+  const char *mdnames[] = { NULL, "SHA512" };
+  const size_t msglen = 64 * 1024 + 17, chunklen = 1000;
+  size_t siglen, i, j;
+
+  int testresult = 1;
+
+  if (!alg_is_enabled(sigalg_name))
+     return 1;
+
+  testresult &=
+    (msg = OPENSSL_malloc(msglen)) != NULL
+    && (ctx = EVP_PKEY_CTX_new_from_name(libctx, sigalg_name, NULL)) != NULL
+    && EVP_PKEY_keygen_init(ctx)
+    && EVP_PKEY_generate(ctx, &key)
+    && (mdctx = EVP_MD_CTX_new()) != NULL;
+  if (!testresult)
+    goto end;
+  for (i = 0; i < msglen; i++)
+    msg[i] = (unsigned char)(i * 31);
+
+  for (j = 0; testresult && j < sizeof(mdnames)/sizeof(mdnames[0]); j++) {
+    // built-in digests are only available with the default provider
+    if (mdnames[j] != NULL && !OSSL_PROVIDER_available(libctx, "default"))
+      continue;
+
+    testresult &= EVP_DigestSignInit_ex(mdctx, NULL, mdnames[j], libctx, NULL, key, NULL);
+    for (i = 0; testresult && i < msglen; i += chunklen)
+      testresult &= EVP_DigestSignUpdate(mdctx, msg + i,
+                                         msglen - i < chunklen ? msglen - i : chunklen);
+    OPENSSL_free(sig);
+    sig = NULL;
+    testresult &=
+      EVP_DigestSignFinal(mdctx, NULL, &siglen)
+      && (sig = OPENSSL_malloc(siglen)) != NULL
+      && EVP_DigestSignFinal(mdctx, sig, &siglen)
+      && EVP_DigestVerifyInit_ex(mdctx, NULL, mdnames[j], libctx, NULL, key, NULL)
+      && EVP_DigestVerifyUpdate(mdctx, msg, msglen)
+      && EVP_DigestVerifyFinal(mdctx, sig, siglen);
+    if (!testresult)
+      break;
+
+    testresult &=
+      EVP_DigestSignInit_ex(mdctx, NULL, mdnames[j], libctx, NULL, key, NULL)
+      && EVP_DigestSignUpdate(mdctx, msg, msglen)
+      && EVP_DigestSignFinal(mdctx, NULL, &siglen)
+      && EVP_DigestSignFinal(mdctx, sig, &siglen)
+      && EVP_DigestVerifyInit_ex(mdctx, NULL, mdnames[j], libctx, NULL, key, NULL);
+    for (i = 0; testresult && i < msglen; i += chunklen)
+      testresult &= EVP_DigestVerifyUpdate(mdctx, msg + i,
+                                           msglen - i < chunklen ? msglen - i : chunklen);
+    testresult &= EVP_DigestVerifyFinal(mdctx, sig, siglen);
+  }
+
+ end:
+  EVP_MD_CTX_free(mdctx);
+  EVP_PKEY_free(key);
+  EVP_PKEY_CTX_free(ctx);
+  OPENSSL_free(sig);
+  OPENSSL_free(msg);
+  return testresult;
+}
+
+// signatures made with classical and PQ halves run concurrently must be
+// interchangeable with those made serially
+static int test_oqs_signatures_parallel(const char *sigalg_name)
+{
+  EVP_MD_CTX *mdctx = NULL;
+  EVP_PKEY_CTX *ctx = NULL;
+  EVP_PKEY *key = NULL;
+  const char msg[] = "The quick brown fox jumps over... you know what";
+  unsigned char *sig = NULL;
+  int on = 1, off = 0;
+  OSSL_PARAM parallel[2] = {
+    OSSL_PARAM_int("hybrid-parallel", &on), OSSL_PARAM_END
+  };
+  OSSL_PARAM serial[2] = {
+    OSSL_PARAM_int("hybrid-parallel", &off), OSSL_PARAM_END
+  };
+  size_t siglen, i;
+
+  int testresult = 1;
+
+  if (!alg_is_enabled(sigalg_name))
+     return 1;
+
+  testresult &=
+    (ctx = EVP_PKEY_CTX_new_from_name(libctx, sigalg_name, NULL)) != NULL
+    && EVP_PKEY_keygen_init(ctx)
+    && EVP_PKEY_generate(ctx, &key)
+    && (mdctx = EVP_MD_CTX_new()) != NULL
+    && EVP_DigestSignInit_ex(mdctx, NULL, NULL, libctx, NULL, key, parallel)
+    && EVP_DigestSignUpdate(mdctx, msg, sizeof(msg))
+    && EVP_DigestSignFinal(mdctx, NULL, &siglen)
+    && (sig = OPENSSL_malloc(siglen)) != NULL
+    && EVP_DigestSignFinal(mdctx, sig, &siglen)
+    && EVP_DigestVerifyInit_ex(mdctx, NULL, NULL, libctx, NULL, key, serial)
+    && EVP_DigestVerifyUpdate(mdctx, msg, sizeof(msg))
+    && EVP_DigestVerifyFinal(mdctx, sig, siglen);
+  for (i = 0; testresult && i < 3; i++)
+    testresult &=
+      EVP_DigestSignInit_ex(mdctx, NULL, NULL, libctx, NULL, key, serial)
+      && EVP_DigestSignUpdate(mdctx, msg, sizeof(msg))
+      && EVP_DigestSignFinal(mdctx, NULL, &siglen)
+      && EVP_DigestSignFinal(mdctx, sig, &siglen)
+      && EVP_DigestVerifyInit_ex(mdctx, NULL, NULL, libctx, NULL, key, parallel)
+      && EVP_DigestVerifyUpdate(mdctx, msg, sizeof(msg))
+      && EVP_DigestVerifyFinal(mdctx, sig, siglen);
+  if (testresult) {
+    // a broken PQ half must be noticed also when verified on a worker thread
+    sig[siglen - 1] = ~sig[siglen - 1];
+    testresult &=
+      EVP_DigestVerifyInit_ex(mdctx, NULL, NULL, libctx, NULL, key, parallel)
+      && EVP_DigestVerifyUpdate(mdctx, msg, sizeof(msg))
+      && !EVP_DigestVerifyFinal(mdctx, sig, siglen);
+  }
+
+  EVP_MD_CTX_free(mdctx);
+  EVP_PKEY_free(key);
+  EVP_PKEY_CTX_free(ctx);
+  OPENSSL_free(sig);
+  return testresult;
+}
+
+static int sign_and_verify(EVP_PKEY *key)
+{
+  EVP_MD_CTX *mdctx = NULL;
+  const char msg[] = "The quick brown fox jumps over... you know what";
+  unsigned char *sig = NULL;
+  size_t siglen;
+  int ret;
+
+  ret = (mdctx = EVP_MD_CTX_new()) != NULL
+        && EVP_DigestSignInit_ex(mdctx, NULL, NULL, libctx, NULL, key, NULL)
+        && EVP_DigestSign(mdctx, NULL, &siglen, (const unsigned char *)msg, sizeof(msg))
+        && (sig = OPENSSL_malloc(siglen)) != NULL
+        && EVP_DigestSign(mdctx, sig, &siglen, (const unsigned char *)msg, sizeof(msg))
+        && EVP_DigestVerifyInit_ex(mdctx, NULL, NULL, libctx, NULL, key, NULL)
+        && EVP_DigestVerify(mdctx, sig, siglen, (const unsigned char *)msg, sizeof(msg));
+  EVP_MD_CTX_free(mdctx);
+  OPENSSL_free(sig);
+  return ret;
+}
+
+static int test_oqs_signatures_keygen_validation(const char *sigalg_name)
+{
+  static const char *levels[] = { "off", "classical", "full" };
+  EVP_PKEY_CTX *ctx = NULL;
+  EVP_PKEY *key = NULL;
+  OSSL_PARAM params[2];
+  size_t i;
+
+  int testresult = 1;
+
+  if (!alg_is_enabled(sigalg_name))
+     return 1;
+
+  testresult &=
+    (ctx = EVP_PKEY_CTX_new_from_name(libctx, sigalg_name, NULL)) != NULL
+    && EVP_PKEY_keygen_init(ctx);
+  for (i = 0; testresult && i < sizeof(levels)/sizeof(levels[0]); i++) {
+    params[0] = OSSL_PARAM_construct_utf8_string("keygen-validation",
+                                                 (char *)levels[i], 0);
+    params[1] = OSSL_PARAM_construct_end();
+    testresult &=
+      EVP_PKEY_CTX_set_params(ctx, params)
+      && EVP_PKEY_generate(ctx, &key)
+      && sign_and_verify(key);
+    EVP_PKEY_free(key);
+    key = NULL;
+  }
+  // unknown levels are rejected
+  params[0] = OSSL_PARAM_construct_utf8_string("keygen-validation", "some", 0);
+  testresult &= testresult && !EVP_PKEY_CTX_set_params(ctx, params);
+  ERR_clear_error();
+
+  EVP_PKEY_CTX_free(ctx);
+  return testresult;
+}
+
+static int sign_raw(EVP_PKEY *key, const unsigned char *tbs, size_t tbslen,
+                    unsigned char **sig, size_t *siglen)
+{
+  EVP_PKEY_CTX *ctx;
+  int ret;
+
+  ret = (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, key, NULL)) != NULL
+    && EVP_PKEY_sign_init(ctx)
+    && EVP_PKEY_sign(ctx, NULL, siglen, tbs, tbslen)
+    && (*sig = OPENSSL_malloc(*siglen)) != NULL
+    && EVP_PKEY_sign(ctx, *sig, siglen, tbs, tbslen);
+  EVP_PKEY_CTX_free(ctx);
+  return ret;
+}
+
+// repeated operations on one context and on a duplicate of it, which
+// share the classical context set up for hybrids by init
+static int test_oqs_signatures_reuse(const char *sigalg_name)
+{
+  EVP_PKEY_CTX *ctx = NULL, *dup = NULL, *vctx = NULL;
+  EVP_PKEY *key = NULL;
+  const char msg[] = "The quick brown fox jumps over... you know what";
+  unsigned char *sig = NULL;
+  size_t siglen = 0, maxsiglen = 0;
+  int i;
+
+  int testresult = 1;
+
+  if (!alg_is_enabled(sigalg_name)) {
+     printf("Not testing disabled algorithm %s.\n", sigalg_name);
+     return 1;
+  }
+  testresult &=
+      (ctx = EVP_PKEY_CTX_new_from_name(libctx, sigalg_name, NULL)) != NULL
+      && EVP_PKEY_keygen_init(ctx) && EVP_PKEY_generate(ctx, &key);
+  EVP_PKEY_CTX_free(ctx);
+  ctx = NULL;
+
+  testresult = testresult
+      && (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, key, NULL)) != NULL
+      && (vctx = EVP_PKEY_CTX_new_from_pkey(libctx, key, NULL)) != NULL
+      && EVP_PKEY_sign_init(ctx) && EVP_PKEY_verify_init(vctx)
+      && EVP_PKEY_sign(ctx, NULL, &maxsiglen, (const unsigned char *)msg, sizeof(msg))
+      && (sig = OPENSSL_malloc(maxsiglen)) != NULL;
+  for (i = 0; testresult && i < 3; i++) {
+    siglen = maxsiglen;
+    testresult = EVP_PKEY_sign(ctx, sig, &siglen, (const unsigned char *)msg, sizeof(msg))
+      && EVP_PKEY_verify(vctx, sig, siglen, (const unsigned char *)msg, sizeof(msg)) == 1;
+  }
+  siglen = maxsiglen;
+  testresult = testresult
+      && (dup = EVP_PKEY_CTX_dup(ctx)) != NULL
+      && EVP_PKEY_sign(dup, sig, &siglen, (const unsigned char *)msg, sizeof(msg))
+      && EVP_PKEY_verify(vctx, sig, siglen, (const unsigned char *)msg, sizeof(msg)) == 1;
+  EVP_PKEY_CTX_free(dup);
+  dup = NULL;
+  testresult = testresult
+      && (dup = EVP_PKEY_CTX_dup(vctx)) != NULL
+      && EVP_PKEY_verify(dup, sig, siglen, (const unsigned char *)msg, sizeof(msg)) == 1;
+
+  EVP_PKEY_free(key);
+  EVP_PKEY_CTX_free(ctx);
+  EVP_PKEY_CTX_free(dup);
+  EVP_PKEY_CTX_free(vctx);
+  OPENSSL_free(sig);
+  return testresult;
+}
+
+// a batch mixing the context's key and explicit keys must report exactly
+// the items with broken signatures or mismatching keys as failed
+static int test_oqs_signatures_batch(const char *sigalg_name)
+{
+  enum { NITEMS = 37 };
+  EVP_PKEY_CTX *ctx = NULL;
+  EVP_PKEY *keys[2] = { NULL, NULL };
+  OQSPROV_BATCH_VERIFY_ITEM items[NITEMS];
+  unsigned char msgs[NITEMS][32], *sigs[NITEMS];
+  unsigned char results[(NITEMS + 7) / 8];
+  OQSPROV_BATCH_VERIFY batch = { items, NITEMS, results, 0 };
+  void *pbatch = &batch;
+  OSSL_PARAM params[2] = {
+    OSSL_PARAM_octet_ptr(OQSPROV_PARAM_BATCH_VERIFY, &pbatch, sizeof(batch)),
+    OSSL_PARAM_END
+  };
+  size_t i, expected = 0;
+
+  int testresult = 1;
+
+  if (!alg_is_enabled(sigalg_name))
+     return 1;
+
+  memset(sigs, 0, sizeof(sigs));
+  for (i = 0; testresult && i < 2; i++) {
+    testresult &=
+      (ctx = EVP_PKEY_CTX_new_from_name(libctx, sigalg_name, NULL)) != NULL
+      && EVP_PKEY_keygen_init(ctx)
+      && EVP_PKEY_generate(ctx, &keys[i]);
+    EVP_PKEY_CTX_free(ctx);
+    ctx = NULL;
+  }
+  for (i = 0; testresult && i < NITEMS; i++) {
+    memset(msgs[i], (int)i, sizeof(msgs[i]));
+    items[i].key = i % 3 == 0 ? NULL : keys[i % 3 - 1];
+    items[i].tbs = msgs[i];
+    items[i].tbslen = sizeof(msgs[i]) - i % 5;
+    testresult &= sign_raw(i % 3 == 2 ? keys[1] : keys[0], items[i].tbs,
+                           items[i].tbslen, &sigs[i], &items[i].siglen);
+    items[i].sig = sigs[i];
+  }
+  if (testresult) {
+    sigs[4][items[4].siglen - 1] ^= 1;
+    sigs[30][0] ^= 0x80;
+    items[17].key = keys[0]; // signed with keys[1]
+  }
+  testresult &=
+    (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, keys[0], NULL)) != NULL
+    && EVP_PKEY_verify_init(ctx)
+    && EVP_PKEY_CTX_set_params(ctx, params);
+  for (i = 0; testresult && i < NITEMS; i++) {
+    int ok = i != 4 && i != 17 && i != 30;
+
+    expected += ok;
+    testresult &= !!(results[i / 8] & (1 << (i % 8))) == ok;
+  }
+  testresult &= batch.nverified == expected;
+
+  for (i = 0; i < NITEMS; i++)
+    OPENSSL_free(sigs[i]);
+  EVP_PKEY_CTX_free(ctx);
+  EVP_PKEY_free(keys[0]);
+  EVP_PKEY_free(keys[1]);
+  return testresult;
+}
+
+// every signature of a batch, signed serially or in parallel, must verify
+// on its own; a batch with a too small buffer must fail
+static int test_oqs_signatures_batch_sign(const char *sigalg_name)
+{
+  enum { NITEMS = 19 };
+  EVP_PKEY_CTX *ctx = NULL, *vctx = NULL;
+  EVP_PKEY *key = NULL;
+  OQSPROV_BATCH_SIGN_ITEM items[NITEMS];
+  unsigned char msgs[NITEMS][40], *sigbuf = NULL;
+  OQSPROV_BATCH_SIGN batch = { items, NITEMS, 0, 0 };
+  void *pbatch = &batch;
+  OSSL_PARAM params[2] = {
+    OSSL_PARAM_octet_ptr(OQSPROV_PARAM_BATCH_SIGN, &pbatch, sizeof(batch)),
+    OSSL_PARAM_END
+  };
+  size_t maxsiglen = 0, i;
+
+  int testresult = 1;
+
+  if (!alg_is_enabled(sigalg_name))
+     return 1;
+
+  testresult &=
+    (ctx = EVP_PKEY_CTX_new_from_name(libctx, sigalg_name, NULL)) != NULL
+    && EVP_PKEY_keygen_init(ctx)
+    && EVP_PKEY_generate(ctx, &key);
+  EVP_PKEY_CTX_free(ctx);
+  ctx = NULL;
+  testresult &=
+    testresult
+    && (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, key, NULL)) != NULL
+    && (vctx = EVP_PKEY_CTX_new_from_pkey(libctx, key, NULL)) != NULL
+    && EVP_PKEY_sign_init(ctx)
+    && EVP_PKEY_verify_init(vctx)
+    && EVP_PKEY_sign(ctx, NULL, &maxsiglen, msgs[0], sizeof(msgs[0]))
+    && (sigbuf = OPENSSL_malloc(NITEMS * maxsiglen)) != NULL;
+  for (batch.parallel = 0; testresult && batch.parallel < 2; batch.parallel++) {
+    for (i = 0; i < NITEMS; i++) {
+      memset(msgs[i], (int)(i + 7 * batch.parallel), sizeof(msgs[i]));
+      items[i].tbs = msgs[i];
+      items[i].tbslen = sizeof(msgs[i]) - i % 3;
+      items[i].sig = sigbuf + i * maxsiglen;
+      items[i].siglen = maxsiglen;
+    }
+    testresult &=
+      EVP_PKEY_CTX_set_params(ctx, params)
+      && batch.nsigned == NITEMS;
+    for (i = 0; testresult && i < NITEMS; i++)
+      testresult &= EVP_PKEY_verify(vctx, items[i].sig, items[i].siglen,
+                                    items[i].tbs, items[i].tbslen) == 1;
+  }
+  if (testresult) {
+    for (i = 0; i < NITEMS; i++)
+      items[i].siglen = maxsiglen;
+    items[NITEMS - 1].siglen = maxsiglen - 1;
+    testresult &= !EVP_PKEY_CTX_set_params(ctx, params)
+      && batch.nsigned == NITEMS - 1 && items[NITEMS - 1].siglen == 0;
+    ERR_clear_error();
+  }
+
+  OPENSSL_free(sigbuf);
+  EVP_PKEY_CTX_free(vctx);
+  EVP_PKEY_CTX_free(ctx);
+  EVP_PKEY_free(key);
+  return testresult;
+}
+
+static int get_verify_cache_stats(OSSL_PROVIDER *prov, size_t *hits, size_t *misses)
+{
+  OSSL_PARAM params[3];
+
+  params[0] = OSSL_PARAM_construct_size_t("verify-cache-hits", hits);
+  params[1] = OSSL_PARAM_construct_size_t("verify-cache-misses", misses);
+  params[2] = OSSL_PARAM_construct_end();
+  return OSSL_PROVIDER_get_params(prov, params);
+}
+
+// with a verify cache configured, repeating a verification must hit the
+// cache, while modified signatures, data or keys must still fail to verify
+static int test_oqs_signatures_verify_cache(const char *sigalg_name)
+{
+  OSSL_PROVIDER *prov = NULL;
+  EVP_PKEY_CTX *ctx = NULL, *vctx = NULL, *vctx2 = NULL;
+  EVP_PKEY *key = NULL, *key2 = NULL;
+  unsigned char msg[] = "The quick brown fox jumps over... you know what";
+  unsigned char *sig = NULL;
+  size_t siglen = 0, hits0, misses0, hits, misses;
+
+  int testresult = 1;
+
+  if (!alg_is_enabled(sigalg_name))
+     return 1;
+
+  testresult &=
+    (prov = OSSL_PROVIDER_load(libctx, modulename)) != NULL
+    && (ctx = EVP_PKEY_CTX_new_from_name(libctx, sigalg_name, NULL)) != NULL
+    && EVP_PKEY_keygen_init(ctx)
+    && EVP_PKEY_generate(ctx, &key)
+    && EVP_PKEY_generate(ctx, &key2)
+    && sign_raw(key, msg, sizeof(msg), &sig, &siglen)
+    && (vctx = EVP_PKEY_CTX_new_from_pkey(libctx, key, NULL)) != NULL
+    && (vctx2 = EVP_PKEY_CTX_new_from_pkey(libctx, key2, NULL)) != NULL
+    && EVP_PKEY_verify_init(vctx)
+    && EVP_PKEY_verify_init(vctx2)
+    && get_verify_cache_stats(prov, &hits0, &misses0)
+    && EVP_PKEY_verify(vctx, sig, siglen, msg, sizeof(msg)) == 1
+    && get_verify_cache_stats(prov, &hits, &misses);
+  if (!testresult || misses == misses0)
+    goto end; // no verify cache configured
+
+  testresult &=
+    EVP_PKEY_verify(vctx, sig, siglen, msg, sizeof(msg)) == 1
+    && get_verify_cache_stats(prov, &hits, &misses)
+    && hits == hits0 + 1;
+  sig[siglen - 1] ^= 1;
+  testresult &= EVP_PKEY_verify(vctx, sig, siglen, msg, sizeof(msg)) != 1;
+  sig[siglen - 1] ^= 1;
+  msg[0] ^= 1;
+  testresult &= EVP_PKEY_verify(vctx, sig, siglen, msg, sizeof(msg)) != 1;
+  msg[0] ^= 1;
+  testresult &=
+    EVP_PKEY_verify(vctx2, sig, siglen, msg, sizeof(msg)) != 1
+    && EVP_PKEY_verify(vctx, sig, siglen - 1, msg, sizeof(msg)) != 1
+    && get_verify_cache_stats(prov, &hits, &misses)
+    && hits == hits0 + 1
+    && EVP_PKEY_verify(vctx, sig, siglen, msg, sizeof(msg)) == 1
+    && get_verify_cache_stats(prov, &hits, &misses)
+    && hits == hits0 + 2;
+  ERR_clear_error();
+
+ end:
+  OPENSSL_free(sig);
+  EVP_PKEY_CTX_free(vctx);
+  EVP_PKEY_CTX_free(vctx2);
+  EVP_PKEY_CTX_free(ctx);
+  EVP_PKEY_free(key);
+  EVP_PKEY_free(key2);
+  OSSL_PROVIDER_unload(prov);
+  return testresult;
+}
+
+static int get_op_counts(OSSL_PROVIDER *prov, size_t *keygens, size_t *signs,
+                         size_t *verifies)
+{
+  OSSL_PARAM params[4];
+
+  params[0] = OSSL_PARAM_construct_size_t("keygen-count", keygens);
+  params[1] = OSSL_PARAM_construct_size_t("sign-count", signs);
+  params[2] = OSSL_PARAM_construct_size_t("verify-count", verifies);
+  params[3] = OSSL_PARAM_construct_end();
+  return OSSL_PROVIDER_get_params(prov, params);
+}
+
+// every operation must be counted, and the algorithm must show up in the
+// report with as many signatures in its latency histogram as it has calls
+static int test_oqs_signatures_stats(const char *sigalg_name)
+{
+  OSSL_PROVIDER *prov = NULL;
+  EVP_PKEY_CTX *ctx = NULL;
+  EVP_PKEY *key = NULL;
+  const unsigned char msg[] = "The quick brown fox jumps over... you know what";
+  unsigned char *sig = NULL;
+  char *report = NULL, *line, *next, alg[64], op[16];
+  size_t siglen = 0, keygens0, signs0, verifies0, keygens, signs, verifies;
+  unsigned long long count = 0, errors, total_us, buckets = 0;
+  OSSL_PARAM params[2];
+  int n, found = 0;
+
+  int testresult = 1;
+
+  if (!alg_is_enabled(sigalg_name))
+     return 1;
+
+  testresult &=
+    (prov = OSSL_PROVIDER_load(libctx, modulename)) != NULL
+    && get_op_counts(prov, &keygens0, &signs0, &verifies0)
+    && (ctx = EVP_PKEY_CTX_new_from_name(libctx, sigalg_name, NULL)) != NULL
+    && EVP_PKEY_keygen_init(ctx)
+    && EVP_PKEY_generate(ctx, &key)
+    && sign_raw(key, msg, sizeof(msg), &sig, &siglen);
+  EVP_PKEY_CTX_free(ctx);
+  ctx = NULL;
+  testresult = testresult
+    && (ctx = EVP_PKEY_CTX_new_from_pkey(libctx, key, NULL)) != NULL
+    && EVP_PKEY_verify_init(ctx)
+    && EVP_PKEY_verify(ctx, sig, siglen, msg, sizeof(msg)) == 1
+    && get_op_counts(prov, &keygens, &signs, &verifies)
+    && keygens == keygens0 + 1 && signs == signs0 + 1 && verifies == verifies0 + 1;
+
+  params[0] = OSSL_PARAM_construct_utf8_string("op-stats", NULL, 0);
+  params[1] = OSSL_PARAM_construct_end();
+  testresult = testresult
+    && OSSL_PROVIDER_get_params(prov, params)
+    && (report = OPENSSL_zalloc(params[0].return_size + 64)) != NULL;
+  if (testresult) {
+    params[0] = OSSL_PARAM_construct_utf8_string("op-stats", report,
+                                                 params[0].return_size + 64);
+    testresult = OSSL_PROVIDER_get_params(prov, params);
+    // "<algorithm> <operation> <count> <errors> <total us> <bucket>,...,<bucket>"
+    for (line = report; testresult && !found && *line != '\0'; line = next + 1) {
+      if ((next = strchr(line, '\n')) == NULL)
+        break;
+      *next = '\0';
+      if (sscanf(line, "%63s %15s %llu %llu %llu %n", alg, op, &count, &errors,
+                 &total_us, &n) == 5
+          && strcmp(alg, sigalg_name) == 0 && strcmp(op, "sign") == 0) {
+        found = 1;
+        for (line += n; *line != '\0'; line = next + (*next == ',')) {
+          buckets += strtoull(line, &next, 10);
+          if (next == line)
+            break;
+        }
+      }
+    }
+    testresult &= found && count >= 1 && errors == 0 && buckets == count;
+  }
+
+  OPENSSL_free(report);
+  OPENSSL_free(sig);
+  EVP_PKEY_CTX_free(ctx);
+  EVP_PKEY_free(key);
+  OSSL_PROVIDER_unload(prov);
+  return testresult;
+}
+
 #define nelem(a) (sizeof(a)/sizeof((a)[0]))
 
 int main(int argc, char *argv[])
@@ -148,7 +697,15 @@ int main(int argc, char *argv[])
   T(OSSL_PROVIDER_available(libctx, modulename));
 
   for (i = 0; i < nelem(sigalg_names); i++) {
-    if (test_oqs_signatures(sigalg_names[i])) {
+    if (test_oqs_signatures(sigalg_names[i])
+        && test_oqs_signatures_streaming(sigalg_names[i])
+        && test_oqs_signatures_parallel(sigalg_names[i])
+        && test_oqs_signatures_keygen_validation(sigalg_names[i])
+        && test_oqs_signatures_reuse(sigalg_names[i])
+        && test_oqs_signatures_batch(sigalg_names[i])
+        && test_oqs_signatures_batch_sign(sigalg_names[i])
+        && test_oqs_signatures_verify_cache(sigalg_names[i])
+        && test_oqs_signatures_stats(sigalg_names[i])) {
       fprintf(stderr,
               cGREEN "  Signature test succeeded: %s" cNORM "\n",
               sigalg_names[i]);